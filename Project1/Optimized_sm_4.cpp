@@ -3,10 +3,524 @@
 #include <iomanip>
 #include <immintrin.h>
 #include <array>
+#include <cstdint>
 #include <chrono>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+#include <deque>
+#include <string>
+#include <memory>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <filesystem>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SM4_TARGET(features)
+#define SM4_FLATTEN
+#define SM4_INLINE __forceinline
+#else
+#include <cpuid.h>
+// GCC/Clang°ָļԻx86-64룬
+// ͬһִļڲ֧AVX2ĻԶ˻رʵ
+#define SM4_TARGET(features) __attribute__((target(features)))
+#define SM4_FLATTEN __attribute__((flatten))
+#define SM4_INLINE __attribute__((always_inline)) inline
+#ifndef __clang__
+// λƬģǿtargetԵУABI
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+#endif
 using namespace std;
 
+// ·ECB/CTR/CBCʵַʽ
+enum class SM4Impl {
+    Scalar, // ʵ
+    AVX2,   // ԤT + AVX2 gather
+    AESNI,  // AVX2 + ͬ + AESENCLAST
+    GFNI    // AVX2 + ͬ + GF2P8AFFINEINVQB
+};
+
+// λƬλƽȣSM4Impl޹
+enum class SM4BitsliceWidth {
+    Auto,   // CPUѡAVX-512 > AVX2 > 64λ
+    W64,    // uint64_tÿ64
+    AVX2,   // __m256iÿ256
+    AVX512  // __m512iÿ512
+};
+
+// ȡCPUID
+static inline void cpuidex(unsigned int leaf, unsigned int subleaf, unsigned int r[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int t[4];
+    __cpuidex(t, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; i++) {
+        r[i] = static_cast<unsigned int>(t[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// ȡXCR0ϵͳǷ񱣴YMM/ZMMĴ״̬
+static inline unsigned long long xgetbv0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+}
+
+// CPU
+struct CpuFeatures {
+    bool avx2;
+    bool aesni;
+    bool gfni;
+    bool avx512f;
+    bool pclmul;    // PCLMULQDQ + SSSE3
+};
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures f = { false, false, false, false, false };
+    unsigned int r0[4], r1[4], r7[4];
+    cpuidex(0, 0, r0);
+    if (r0[0] < 7) {
+        return f;
+    }
+    cpuidex(1, 0, r1);
+    cpuidex(7, 0, r7);
+
+    // AVXָҪϵͳOSXSAVEӦļĴ״̬
+    bool osxsave = (r1[2] >> 27) & 1;
+    unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    bool ymm = (xcr0 & 0x06) == 0x06;
+    bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+    f.avx2 = ymm && ((r1[2] >> 28) & 1) && ((r7[1] >> 5) & 1);
+    f.aesni = (r1[2] >> 25) & 1;
+    f.gfni = (r7[2] >> 8) & 1;
+    f.avx512f = zmm && f.avx2 && ((r7[1] >> 16) & 1);
+    f.pclmul = ((r1[2] >> 1) & 1) && ((r1[2] >> 9) & 1);
+    return f;
+}
+
+// ֻ״ʹʱ̽һ
+static const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures f = detectCpuFeatures();
+    return f;
+}
+
+// ǰCPUǷָ֧ʵ
+static bool sm4ImplSupported(SM4Impl impl) {
+    const CpuFeatures& f = cpuFeatures();
+    switch (impl) {
+    case SM4Impl::AVX2:
+        return f.avx2;
+    case SM4Impl::AESNI:
+        return f.avx2 && f.aesni;
+    case SM4Impl::GFNI:
+        return f.avx2 && f.gfni;
+    default:
+        return true;
+    }
+}
+
+//  GFNI > AES-NI > AVX2 >  ˳ѡ
+static SM4Impl sm4BestImpl() {
+    static const SM4Impl best =
+        sm4ImplSupported(SM4Impl::GFNI) ? SM4Impl::GFNI :
+        sm4ImplSupported(SM4Impl::AESNI) ? SM4Impl::AESNI :
+        sm4ImplSupported(SM4Impl::AVX2) ? SM4Impl::AVX2 : SM4Impl::Scalar;
+    return best;
+}
+
+// ߳ӿʹõĳפ̳߳أڹ״ʹʱ
+// ÿ̳߳һ䣬ǰȡԼȡ
+// ߳ĺȡٶȲһɵĸز
+class SM4ThreadPool {
+public:
+    static SM4ThreadPool& instance() {
+        static SM4ThreadPool pool;
+        return pool;
+    }
+
+    // ִbody(0) .. body(numTasks - 1)threads̲߳루̣߳ʱȫ
+    // ͬ߳ͬʱʱִ
+    template <typename F>
+    void run(size_t numTasks, unsigned threads, const F& body) {
+        lock_guard<mutex> serial(runMutex);
+        threads = static_cast<unsigned>(min<size_t>(threads, numTasks));
+        if (threads > MAX_THREADS) {
+            threads = MAX_THREADS;
+        }
+        if (threads <= 1) {
+            for (size_t i = 0; i < numTasks; i++) {
+                body(i);
+            }
+            return;
+        }
+        {
+            unique_lock<mutex> lock(m);
+            while (workers.size() + 1 < threads) {
+                unsigned id = static_cast<unsigned>(workers.size() + 1);
+                workers.emplace_back(&SM4ThreadPool::workerMain, this, id);
+            }
+
+            // ʼʱƽ߳
+            for (unsigned t = 0; t < threads; t++) {
+                ranges[t].store(pack(numTasks * t / threads, numTasks * (t + 1) / threads));
+            }
+            invoke = [](const void* f, size_t i) { (*static_cast<const F*>(f))(i); };
+            context = &body;
+            jobThreads = threads;
+            active = threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [this] { return active == 0; });
+    }
+
+    ~SM4ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_all();
+        for (thread& t : workers) {
+            t.join();
+        }
+    }
+
+private:
+    static const unsigned MAX_THREADS = 256;
+
+    // [begin, end)һ64λԭУȡȡCAS
+    struct alignas(64) Range {
+        atomic<uint64_t> v;
+        void store(uint64_t x) { v.store(x, memory_order_relaxed); }
+    };
+
+    static uint64_t pack(size_t begin, size_t end) {
+        return static_cast<uint64_t>(begin) | (static_cast<uint64_t>(end) << 32);
+    }
+
+    SM4ThreadPool() {}
+
+    // Լǰȡһ
+    bool pop(unsigned id, size_t& task) {
+        uint64_t cur = ranges[id].v.load(memory_order_acquire);
+        for (;;) {
+            uint64_t begin = cur & 0xFFFFFFFF, end = cur >> 32;
+            if (begin >= end) {
+                return false;
+            }
+            if (ranges[id].v.compare_exchange_weak(cur, pack(begin + 1, end), memory_order_acq_rel)) {
+                task = begin;
+                return true;
+            }
+        }
+    }
+
+    // ߳ȡʣĺΣȡһִУԼ
+    bool steal(unsigned id, size_t& task) {
+        for (unsigned k = 1; k < jobThreads; k++) {
+            unsigned victim = (id + k) % jobThreads;
+            uint64_t cur = ranges[victim].v.load(memory_order_acquire);
+            for (;;) {
+                uint64_t begin = cur & 0xFFFFFFFF, end = cur >> 32;
+                if (begin >= end) {
+                    break;
+                }
+                uint64_t mid = begin + (end - begin) / 2;
+                if (ranges[victim].v.compare_exchange_weak(cur, pack(begin, mid), memory_order_acq_rel)) {
+                    ranges[id].v.store(pack(mid + 1, end), memory_order_release);
+                    task = mid;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned id) {
+        size_t task;
+        while (pop(id, task) || steal(id, task)) {
+            invoke(context, task);
+        }
+    }
+
+    void workerMain(unsigned id) {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [&] { return stop || (generation != seen && id < jobThreads); });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+            }
+            work(id);
+            {
+                lock_guard<mutex> lock(m);
+                active--;
+            }
+            done.notify_one();
+        }
+    }
+
+    mutex runMutex;
+    mutex m;
+    condition_variable wake;
+    condition_variable done;
+    vector<thread> workers;
+    Range ranges[MAX_THREADS];
+    void (*invoke)(const void*, size_t) = nullptr;
+    const void* context = nullptr;
+    unsigned jobThreads = 0;
+    unsigned active = 0;
+    unsigned long long generation = 0;
+    bool stop = false;
+};
+
+#ifdef SM4_INSTRUMENT
+// ==================== ʱͳƣʱSM4_INSTRUMENTã ====================
+// ÿ߳һݼֻ߳д루relaxedԭãʱ̡߳
+// δSM4_INSTRUMENTʱӿеSM4_TRACE룬·ûжָ
+
+// ͳƵĲ
+enum class SM4Op { KeySetup, ECB, CTR, CBC, XTS, GCM, Bitsliced, MultiKey, Count };
+
+class SM4Metrics {
+public:
+    static const int OPS = static_cast<int>(SM4Op::Count);
+    static const int IMPLS = 4;
+    static const int BUCKETS = 40;  // ӳֱͼiͰΪ[2^i, 2^(i+1))TSC
+
+    // ٻصÿεýʱڵִ߳Уб֤̰߳ȫ
+    typedef void (*TraceHook)(SM4Op op, SM4Impl impl, size_t bytes, unsigned long long cycles);
+
+    // ¼һεãSM4Traceʱã
+    static void record(SM4Op op, SM4Impl impl, size_t bytes, unsigned long long cycles) {
+        ThreadStats& s = local();
+        int o = static_cast<int>(op);
+        bump(s.calls[o], 1);
+        bump(s.bytes[o], bytes);
+        bump(s.cycles[o], cycles);
+        bump(s.hist[o][bucketOf(cycles)], 1);
+        if (op != SM4Op::KeySetup) {
+            bump(s.implCalls[static_cast<int>(impl)], 1);
+            // ӿ䵽ʵ֣CPUָֻ֧ΪScalar
+            if (impl == SM4Impl::Scalar) {
+                bump(s.fallback, 1);
+            }
+        }
+        TraceHook h = hook().load(memory_order_relaxed);
+        if (h) {
+            h(op, impl, bytes, cycles);
+        }
+    }
+
+    // øٻصnullptrΪر
+    static void setTraceHook(TraceHook h) {
+        hook().store(h, memory_order_relaxed);
+    }
+
+    // ̣߳˳̣߳ļPrometheusıʽ
+    static string exportText() {
+        static const char* const opNames[OPS] = {
+            "key_setup", "ecb", "ctr", "cbc", "xts", "gcm", "bitsliced", "multi_key"
+        };
+        static const char* const implNames[IMPLS] = { "scalar", "avx2", "aesni", "gfni" };
+
+        unsigned long long calls[OPS] = {}, bytes[OPS] = {}, cycles[OPS] = {}, hist[OPS][BUCKETS] = {};
+        unsigned long long implCalls[IMPLS] = {}, fallback = 0;
+        size_t threads;
+        {
+            lock_guard<mutex> lock(registryMutex());
+            threads = registry().size();
+            for (const unique_ptr<ThreadStats>& t : registry()) {
+                for (int o = 0; o < OPS; o++) {
+                    calls[o] += t->calls[o].load(memory_order_relaxed);
+                    bytes[o] += t->bytes[o].load(memory_order_relaxed);
+                    cycles[o] += t->cycles[o].load(memory_order_relaxed);
+                    for (int b = 0; b < BUCKETS; b++) {
+                        hist[o][b] += t->hist[o][b].load(memory_order_relaxed);
+                    }
+                }
+                for (int i = 0; i < IMPLS; i++) {
+                    implCalls[i] += t->implCalls[i].load(memory_order_relaxed);
+                }
+                fallback += t->fallback.load(memory_order_relaxed);
+            }
+        }
+
+        string out;
+        out += "# TYPE sm4_calls_total counter\n";
+        for (int o = 0; o < OPS; o++) {
+            out += "sm4_calls_total{op=\"" + string(opNames[o]) + "\"} " + to_string(calls[o]) + "\n";
+        }
+        out += "# TYPE sm4_bytes_total counter\n";
+        for (int o = 0; o < OPS; o++) {
+            out += "sm4_bytes_total{op=\"" + string(opNames[o]) + "\"} " + to_string(bytes[o]) + "\n";
+        }
+        out += "# TYPE sm4_backend_calls_total counter\n";
+        for (int i = 0; i < IMPLS; i++) {
+            out += "sm4_backend_calls_total{impl=\"" + string(implNames[i]) + "\"} " + to_string(implCalls[i]) + "\n";
+        }
+        out += "# TYPE sm4_scalar_fallback_total counter\n";
+        out += "sm4_scalar_fallback_total " + to_string(fallback) + "\n";
+        out += "# TYPE sm4_threads gauge\n";
+        out += "sm4_threads " + to_string(threads) + "\n";
+        // ֻеõĲͰϽleΪΪۼֵ
+        out += "# TYPE sm4_latency_cycles histogram\n";
+        for (int o = 0; o < OPS; o++) {
+            if (calls[o] == 0) {
+                continue;
+            }
+            string label = "op=\"" + string(opNames[o]) + "\"";
+            unsigned long long cumulative = 0;
+            for (int b = 0; b < BUCKETS; b++) {
+                cumulative += hist[o][b];
+                out += "sm4_latency_cycles_bucket{" + label + ",le=\"" + to_string(2ULL << b) + "\"} "
+                    + to_string(cumulative) + "\n";
+            }
+            out += "sm4_latency_cycles_bucket{" + label + ",le=\"+Inf\"} " + to_string(calls[o]) + "\n";
+            out += "sm4_latency_cycles_sum{" + label + "} " + to_string(cycles[o]) + "\n";
+            out += "sm4_latency_cycles_count{" + label + "} " + to_string(calls[o]) + "\n";
+        }
+        return out;
+    }
+
+    // ̵߳ļڽеĵòʱܼǰ
+    static void reset() {
+        lock_guard<mutex> lock(registryMutex());
+        for (const unique_ptr<ThreadStats>& t : registry()) {
+            for (int o = 0; o < OPS; o++) {
+                t->calls[o].store(0, memory_order_relaxed);
+                t->bytes[o].store(0, memory_order_relaxed);
+                t->cycles[o].store(0, memory_order_relaxed);
+                for (int b = 0; b < BUCKETS; b++) {
+                    t->hist[o][b].store(0, memory_order_relaxed);
+                }
+            }
+            for (int i = 0; i < IMPLS; i++) {
+                t->implCalls[i].store(0, memory_order_relaxed);
+            }
+            t->fallback.store(0, memory_order_relaxed);
+        }
+    }
+
+private:
+    // ̵߳ļɵǼǱУ߳˳Աʱ
+    struct alignas(64) ThreadStats {
+        atomic<unsigned long long> calls[OPS];
+        atomic<unsigned long long> bytes[OPS];
+        atomic<unsigned long long> cycles[OPS];
+        atomic<unsigned long long> hist[OPS][BUCKETS];
+        atomic<unsigned long long> implCalls[IMPLS];
+        atomic<unsigned long long> fallback;
+    };
+
+    // ֻ߳д룬ҪԭӵĶ--д
+    static inline void bump(atomic<unsigned long long>& c, unsigned long long n) {
+        c.store(c.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+
+    static inline int bucketOf(unsigned long long cycles) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long b;
+        _BitScanReverse64(&b, cycles | 1);
+        int bucket = static_cast<int>(b);
+#else
+        int bucket = 63 - __builtin_clzll(cycles | 1);
+#endif
+        return bucket < BUCKETS ? bucket : BUCKETS - 1;
+    }
+
+    static mutex& registryMutex() {
+        static mutex m;
+        return m;
+    }
+
+    static vector<unique_ptr<ThreadStats>>& registry() {
+        static vector<unique_ptr<ThreadStats>> r;
+        return r;
+    }
+
+    static atomic<TraceHook>& hook() {
+        static atomic<TraceHook> h(nullptr);
+        return h;
+    }
+
+    // ߳״μ¼ʱǼ
+    static ThreadStats& local() {
+        thread_local ThreadStats* stats = nullptr;
+        if (!stats) {
+            unique_ptr<ThreadStats> t(new ThreadStats());
+            stats = t.get();
+            lock_guard<mutex> lock(registryMutex());
+            registry().push_back(move(t));
+        }
+        return *stats;
+    }
+};
+
+// ʱʱTSCʱ¼һε
+class SM4Trace {
+public:
+    SM4Trace(SM4Op op, SM4Impl impl, size_t bytes) : op(op), impl(impl), bytes(bytes), start(__rdtsc()) {}
+    ~SM4Trace() {
+        SM4Metrics::record(op, impl, bytes, __rdtsc() - start);
+    }
+    SM4Trace(const SM4Trace&) = delete;
+    SM4Trace& operator=(const SM4Trace&) = delete;
+private:
+    SM4Op op;
+    SM4Impl impl;
+    size_t bytes;
+    unsigned long long start;
+};
+
+#define SM4_TRACE(op, impl, bytes) SM4Trace sm4Trace(SM4Op::op, (impl), (bytes))
+#else
+#define SM4_TRACE(op, impl, bytes)
+#endif
+
+// ԿļԿж룬ΪԿչԿܵ
+struct alignas(64) SM4KeySchedule {
+    unsigned int rk[32];
+};
+
+// ɢ/ۼӿڵһݶΣԭؼ/ܣ
+struct SM4IoVec {
+    unsigned char* base;
+    size_t len;
+};
+
 class SM4 {
+    // GCMںںֱӸֺS
+    friend class SM4GCM;
+    friend class SM4XTS;
 private:
     // S
     static constexpr array<unsigned char, 256> S_BOX = {
@@ -45,41 +559,77 @@ private:
         0x10171E25, 0x2C333A41, 0x484F565D, 0x646B7279
     };
 
-    // ԤT
-    array<unsigned int, 256> T_table;
-    array<unsigned int, 256> T_prime_table;
+    // ԤTt[k][x] = L(S(x) << (24 - 8k))kֽλԤѭλT任
+    // s[x] = S(x)չΪ32λԿչgatherʹ
+    // Կ޹أɣж⣩
+    struct TTable {
+        unsigned int t[4][256];
+        unsigned int s[256];
+    };
+    static const TTable T_TABLE;
 
     // Կ
     array<unsigned int, 32> roundKeys;
+    // ԿãԿչʱһɣ
+    array<unsigned int, 32> decRoundKeys;
+
+    // ·ĺָÿʵһţCPUѡģʽ˵
+    struct Kernels {
+        SM4Impl impl;
+        const char* name;
+        void (*ecb)(const SM4& c, const unsigned char* input, unsigned char* output,
+            size_t numBlocks, const unsigned int* rk);
+        void (*ctr)(const SM4& c, unsigned int ctr[4], const unsigned char* input,
+            unsigned char* output, size_t len);
+        void (*cbcDecrypt)(const SM4& c, unsigned char iv[16], const unsigned char* input,
+            unsigned char* output, size_t numBlocks);
+        void (*cbcEncrypt8)(const SM4& c, unsigned char iv[8][16], const unsigned char* const input[8],
+            unsigned char* const output[8], const size_t numBlocks[8]);
+        void (*xts)(const SM4& c, unsigned char tweak[16], const unsigned char* input,
+            unsigned char* output, size_t numBlocks, const unsigned int* rk);
+        void (*expandKeys)(const unsigned char* keys, SM4KeySchedule* schedules, size_t count);
+        void (*multiKey)(const SM4KeySchedule* schedules, const unsigned char* input,
+            unsigned char* output, size_t numBlocks, bool decrypting);
+        void (*bitsliced)(const unsigned char* input, unsigned char* output,
+            size_t numBlocks, const unsigned int* rk);
+    };
+
+    // ·ʹõʵ
+    const Kernels* kernels;
+
+    // setBitsliceWidthָλƬںˣnullptrʱʹkernelsаCPUѡ
+    void (*bitslicedKernel)(const unsigned char* input, unsigned char* output,
+        size_t numBlocks, const unsigned int* rk) = nullptr;
+
+    // ߳ӿڵ߳0Ϊȫ߼ˣö̵߳С
+    unsigned threadCount;
+    size_t minThreadedBytes;
+
+    // ߳ӿڵķֿСϼ128KBL2
+    static constexpr size_t BULK_CHUNK = 64 * 1024;
 
     // ѭ
-    static inline unsigned int leftRotate(unsigned int word, unsigned int bits) {
+    static constexpr unsigned int leftRotate(unsigned int word, unsigned int bits) {
         return (word << bits) | (word >> (32 - bits));
     }
 
-    // ʼԤ
-    void initLookupTables() {
-        // ԤT
+    // T
+    static constexpr TTable buildTTable() {
+        TTable r = {};
         for (int i = 0; i < 256; i++) {
-            unsigned int b = S_BOX[i];
-            // Ա任L
-            unsigned int r = b;
-            r ^= leftRotate(b, 2);
-            r ^= leftRotate(b, 10);
-            r ^= leftRotate(b, 18);
-            r ^= leftRotate(b, 24);
-            T_table[i] = r;
-
-            // Ա任L'Կչ
-            unsigned int r_prime = b;
-            r_prime ^= leftRotate(b, 13);
-            r_prime ^= leftRotate(b, 23);
-            T_prime_table[i] = r_prime;
+            for (int k = 0; k < 4; k++) {
+                // Ա任L
+                unsigned int b = static_cast<unsigned int>(S_BOX[i]) << (24 - 8 * k);
+                r.t[k][i] = b ^ leftRotate(b, 2) ^ leftRotate(b, 10)
+                    ^ leftRotate(b, 18) ^ leftRotate(b, 24);
+            }
+            r.s[i] = S_BOX[i];
         }
+        return r;
     }
 
     // Ա任
-    unsigned int tauTransform(unsigned int word) {
+    static unsigned int tauTransform(unsigned int word) {
         unsigned int result = 0;
         for (int i = 0; i < 4; i++) {
             unsigned char byte = (word >> (24 - i * 8)) & 0xFF;
@@ -88,23 +638,14 @@ private:
         return result;
     }
 
-    // Tܣ
-    unsigned int tTransform(unsigned int word) {
-        unsigned int b0 = S_BOX[(word >> 24) & 0xFF];
-        unsigned int b1 = S_BOX[(word >> 16) & 0xFF];
-        unsigned int b2 = S_BOX[(word >> 8) & 0xFF];
-        unsigned int b3 = S_BOX[word & 0xFF];
-
-        // ֽڲӦԱ任
-        unsigned int b = (b0 << 24) | (b1 << 16) | (b2 << 8) | b3;
-        return b ^ leftRotate(b, 2)
-            ^ leftRotate(b, 10)
-            ^ leftRotate(b, 18)
-            ^ leftRotate(b, 24);
+    // TܣLԵģֽλøһα
+    static inline unsigned int tTransform(unsigned int word) {
+        return T_TABLE.t[0][word >> 24] ^ T_TABLE.t[1][(word >> 16) & 0xFF]
+            ^ T_TABLE.t[2][(word >> 8) & 0xFF] ^ T_TABLE.t[3][word & 0xFF];
     }
 
     // T'Կչ
-    unsigned int tTransformPrime(unsigned int word) {
+    static unsigned int tTransformPrime(unsigned int word) {
         unsigned int b0 = S_BOX[(word >> 24) & 0xFF];
         unsigned int b1 = S_BOX[(word >> 16) & 0xFF];
         unsigned int b2 = S_BOX[(word >> 8) & 0xFF];
@@ -116,8 +657,8 @@ private:
             ^ leftRotate(b, 23);
     }
 
-    // Կչ
-    void keySchedule(const unsigned char key[16]) {
+    // Կչ16ֽԿ32Կ
+    static void expandKey(const unsigned char key[16], unsigned int rk[32]) {
         // 16ֽԿתΪ432λ֣
         unsigned int k[4];
         for (int i = 0; i < 4; i++) {
@@ -135,83 +676,411 @@ private:
         // 32Կ
         for (int i = 0; i < 32; i++) {
             kx[i + 4] = kx[i] ^ tTransformPrime(kx[i + 1] ^ kx[i + 2] ^ kx[i + 3] ^ CK[i]);
-            roundKeys[i] = kx[i + 4];
+            rk[i] = kx[i + 4];
+        }
+    }
+
+    // ɼԿĽԿ
+    void setRoundKeys(const unsigned int rk[32]) {
+        for (int i = 0; i < 32; i++) {
+            roundKeys[i] = rk[i];
+            decRoundKeys[i] = rk[31 - i];
         }
     }
+
+    void keySchedule(const unsigned char key[16]) {
+        unsigned int rk[32];
+        expandKey(key, rk);
+        setRoundKeys(rk);
+    }
+
     // AVX2ŻT任
-    __m256i tTransformAVX2(__m256i word) const {
+    SM4_TARGET("avx2")
+    static inline __m256i tTransformAVX2(__m256i word) {
 
         __m256i b3 = _mm256_and_si256(word, _mm256_set1_epi32(0xFF));
         __m256i b2 = _mm256_and_si256(_mm256_srli_epi32(word, 8), _mm256_set1_epi32(0xFF));
         __m256i b1 = _mm256_and_si256(_mm256_srli_epi32(word, 16), _mm256_set1_epi32(0xFF));
         __m256i b0 = _mm256_srli_epi32(word, 24);
 
-        // ʹԤT_table
+        // ֽλʹöӦԤλTֱ
         __m256i r0 = _mm256_i32gather_epi32(
-            reinterpret_cast<const int*>(T_table.data()), b0, 4);
+            reinterpret_cast<const int*>(T_TABLE.t[0]), b0, 4);
         __m256i r1 = _mm256_i32gather_epi32(
-            reinterpret_cast<const int*>(T_table.data()), b1, 4);
+            reinterpret_cast<const int*>(T_TABLE.t[1]), b1, 4);
         __m256i r2 = _mm256_i32gather_epi32(
-            reinterpret_cast<const int*>(T_table.data()), b2, 4);
+            reinterpret_cast<const int*>(T_TABLE.t[2]), b2, 4);
         __m256i r3 = _mm256_i32gather_epi32(
-            reinterpret_cast<const int*>(T_table.data()), b3, 4);
+            reinterpret_cast<const int*>(T_TABLE.t[3]), b3, 4);
 
         // ϲ
         return _mm256_xor_si256(
             _mm256_xor_si256(r0, r1),
             _mm256_xor_si256(r2, r3));
     }
+
+    // AVX2Ա任LL(B) = B ^ (B <<< 24) ^ ((B ^ (B <<< 8) ^ (B <<< 16)) <<< 2)
+    SM4_TARGET("avx2")
+    static inline __m256i linearTransformAVX2(__m256i b) {
+        const __m256i rol8 = _mm256_setr_epi8(
+            3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+            3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+        const __m256i rol16 = _mm256_setr_epi8(
+            2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+            2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        const __m256i rol24 = _mm256_setr_epi8(
+            1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+            1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+        __m256i t = _mm256_xor_si256(b, _mm256_xor_si256(
+            _mm256_shuffle_epi8(b, rol8), _mm256_shuffle_epi8(b, rol16)));
+        t = _mm256_or_si256(_mm256_slli_epi32(t, 2), _mm256_srli_epi32(t, 30));
+        return _mm256_xor_si256(_mm256_xor_si256(b, _mm256_shuffle_epi8(b, rol24)), t);
+    }
+
+    // AVX2ʵֵSУԱ任ӣLÿֽڲһ32λS
+    SM4_TARGET("avx2")
+    static inline __m256i sboxAVX2(__m256i word) {
+        const __m256i lowByte = _mm256_set1_epi32(0xFF);
+        const int* s = reinterpret_cast<const int*>(T_TABLE.s);
+        __m256i b0 = _mm256_i32gather_epi32(s, _mm256_srli_epi32(word, 24), 4);
+        __m256i b1 = _mm256_i32gather_epi32(s, _mm256_and_si256(_mm256_srli_epi32(word, 16), lowByte), 4);
+        __m256i b2 = _mm256_i32gather_epi32(s, _mm256_and_si256(_mm256_srli_epi32(word, 8), lowByte), 4);
+        __m256i b3 = _mm256_i32gather_epi32(s, _mm256_and_si256(word, lowByte), 4);
+        return _mm256_or_si256(
+            _mm256_or_si256(_mm256_slli_epi32(b0, 24), _mm256_slli_epi32(b1, 16)),
+            _mm256_or_si256(_mm256_slli_epi32(b2, 8), b3));
+    }
+
+    // GFNIʵֵS
+    // SM4SAESȼۣS(x) = A2Inv_AES(A1x + c1) + c2
+    // GF2P8AFFINEָ32ֽڵS
+    SM4_TARGET("avx2,gfni")
+    static inline __m256i sboxGFNI(__m256i word) {
+        const __m256i a1 = _mm256_set1_epi64x(0x4C287DB91A22505DLL);
+        const __m256i a2 = _mm256_set1_epi64x(static_cast<long long>(0xF3AB34A974A6B589ULL));
+        __m256i b = _mm256_gf2p8affine_epi64_epi8(word, a1, 0x3E);
+        return _mm256_gf2p8affineinv_epi64_epi8(b, a2, 0xD3);
+    }
+
+    // GFNIʵֵT任
+    SM4_TARGET("avx2,gfni")
+    static inline __m256i tTransformGFNI(__m256i word) {
+        return linearTransformAVX2(sboxGFNI(word));
+    }
+
+    // AES-NIʵֵS
+    // /任ðֽڲvpshufbɣмAESENCLASTSubBytes
+    // ԤλԵAESENCLASTеShiftRows
+    SM4_TARGET("avx2,aes")
+    static inline __m256i sboxAESNI(__m256i word) {
+        const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+        const __m256i preLo = _mm256_setr_epi8(
+            0x3E, (char)0xB2, 0x0E, (char)0x82, (char)0xBB, 0x37, (char)0x8B, 0x07,
+            (char)0xA1, 0x2D, (char)0x91, 0x1D, 0x24, (char)0xA8, 0x14, (char)0x98,
+            0x3E, (char)0xB2, 0x0E, (char)0x82, (char)0xBB, 0x37, (char)0x8B, 0x07,
+            (char)0xA1, 0x2D, (char)0x91, 0x1D, 0x24, (char)0xA8, 0x14, (char)0x98);
+        const __m256i preHi = _mm256_setr_epi8(
+            0x00, (char)0xDC, 0x2E, (char)0xF2, (char)0xC5, 0x19, (char)0xEB, 0x37,
+            0x08, (char)0xD4, 0x26, (char)0xFA, (char)0xCD, 0x11, (char)0xE3, 0x3F,
+            0x00, (char)0xDC, 0x2E, (char)0xF2, (char)0xC5, 0x19, (char)0xEB, 0x37,
+            0x08, (char)0xD4, 0x26, (char)0xFA, (char)0xCD, 0x11, (char)0xE3, 0x3F);
+        const __m256i postLo = _mm256_setr_epi8(
+            0x6C, (char)0xD4, (char)0xA6, 0x1E, 0x52, (char)0xEA, (char)0x98, 0x20,
+            0x0B, (char)0xB3, (char)0xC1, 0x79, 0x35, (char)0x8D, (char)0xFF, 0x47,
+            0x6C, (char)0xD4, (char)0xA6, 0x1E, 0x52, (char)0xEA, (char)0x98, 0x20,
+            0x0B, (char)0xB3, (char)0xC1, 0x79, 0x35, (char)0x8D, (char)0xFF, 0x47);
+        const __m256i postHi = _mm256_setr_epi8(
+            0x00, (char)0xE0, 0x50, (char)0xB0, (char)0x9D, 0x7D, (char)0xCD, 0x2D,
+            (char)0xC0, 0x20, (char)0x90, 0x70, 0x5D, (char)0xBD, 0x0D, (char)0xED,
+            0x00, (char)0xE0, 0x50, (char)0xB0, (char)0x9D, 0x7D, (char)0xCD, 0x2D,
+            (char)0xC0, 0x20, (char)0x90, 0x70, 0x5D, (char)0xBD, 0x0D, (char)0xED);
+        const __m256i invShiftRows = _mm256_setr_epi8(
+            0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3,
+            0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+
+        // 任ӳ䵽AES
+        __m256i y = _mm256_xor_si256(
+            _mm256_shuffle_epi8(preLo, _mm256_and_si256(word, lowNibble)),
+            _mm256_shuffle_epi8(preHi, _mm256_and_si256(_mm256_srli_epi16(word, 4), lowNibble)));
+        y = _mm256_shuffle_epi8(y, invShiftRows);
+
+        // AES SubBytes
+        __m128i z0 = _mm_aesenclast_si128(_mm256_castsi256_si128(y), _mm_setzero_si128());
+        __m128i z1 = _mm_aesenclast_si128(_mm256_extracti128_si256(y, 1), _mm_setzero_si128());
+        __m256i z = _mm256_inserti128_si256(_mm256_castsi128_si256(z0), z1, 1);
+
+        // 任ӳSM4SУ
+        return _mm256_xor_si256(
+            _mm256_shuffle_epi8(postLo, _mm256_and_si256(z, lowNibble)),
+            _mm256_shuffle_epi8(postHi, _mm256_and_si256(_mm256_srli_epi16(z, 4), lowNibble)));
+    }
+
+    // AES-NIʵֵT任
+    SM4_TARGET("avx2,aes")
+    static inline __m256i tTransformAESNI(__m256i word) {
+        return linearTransformAVX2(sboxAESNI(word));
+    }
+
     // תú8תΪ״̬
-    static void transpose_4x8_epi32(
+    // 룺in0..in32飨8飬תΪ֣
+    // out0..out3Ϊĵ0..3֣ͨ˳Ϊ0,2,4,6,1,3,5,7
+    // ñ任ģͬһҲתûԭʼ
+    SM4_TARGET("avx2")
+    static inline void transpose_4x8_epi32(
         const __m256i& in0, const __m256i& in1, const __m256i& in2, const __m256i& in3,
-        const __m256i& in4, const __m256i& in5, const __m256i& in6, const __m256i& in7,
         __m256i& out0, __m256i& out1, __m256i& out2, __m256i& out3
     ) {
-        // 32λ128λͨ
-        __m256 a0 = _mm256_castsi256_ps(in0);
-        __m256 a1 = _mm256_castsi256_ps(in1);
-        __m256 a2 = _mm256_castsi256_ps(in2);
-        __m256 a3 = _mm256_castsi256_ps(in3);
-        __m256 a4 = _mm256_castsi256_ps(in4);
-        __m256 a5 = _mm256_castsi256_ps(in5);
-        __m256 a6 = _mm256_castsi256_ps(in6);
-        __m256 a7 = _mm256_castsi256_ps(in7);
-
-        // ת4x4
-        __m256 t0 = _mm256_unpacklo_ps(a0, a1);
-        __m256 t1 = _mm256_unpackhi_ps(a0, a1);
-        __m256 t2 = _mm256_unpacklo_ps(a2, a3);
-        __m256 t3 = _mm256_unpackhi_ps(a2, a3);
-        __m256 t4 = _mm256_unpacklo_ps(a4, a5);
-        __m256 t5 = _mm256_unpackhi_ps(a4, a5);
-        __m256 t6 = _mm256_unpacklo_ps(a6, a7);
-        __m256 t7 = _mm256_unpackhi_ps(a6, a7);
-
-        // ת
-        __m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44);
-        __m256 s1 = _mm256_shuffle_ps(t0, t2, 0xEE);
-        __m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44);
-        __m256 s3 = _mm256_shuffle_ps(t1, t3, 0xEE);
-        __m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44);
-        __m256 s5 = _mm256_shuffle_ps(t4, t6, 0xEE);
-        __m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44);
-        __m256 s7 = _mm256_shuffle_ps(t5, t7, 0xEE);
-
-        // 
-        out0 = _mm256_castps_si256(_mm256_permute2f128_ps(s0, s4, 0x20));
-        out1 = _mm256_castps_si256(_mm256_permute2f128_ps(s1, s5, 0x20));
-        out2 = _mm256_castps_si256(_mm256_permute2f128_ps(s2, s6, 0x20));
-        out3 = _mm256_castps_si256(_mm256_permute2f128_ps(s3, s7, 0x20));
+        // ÿ128λͨת4x4
+        __m256i t0 = _mm256_unpacklo_epi32(in0, in1);
+        __m256i t1 = _mm256_unpackhi_epi32(in0, in1);
+        __m256i t2 = _mm256_unpacklo_epi32(in2, in3);
+        __m256i t3 = _mm256_unpackhi_epi32(in2, in3);
+
+        out0 = _mm256_unpacklo_epi64(t0, t2);
+        out1 = _mm256_unpackhi_epi64(t0, t2);
+        out2 = _mm256_unpacklo_epi64(t1, t3);
+        out3 = _mm256_unpackhi_epi64(t1, t3);
     }
-public:
-    // 캯
-    SM4(const unsigned char key[16]) {
-        initLookupTables();
-        keySchedule(key);
+
+    // 32λֵֽתСڴ <-> ֣
+    SM4_TARGET("avx2")
+    static inline __m256i byteSwapAVX2(__m256i v) {
+        const __m256i mask = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        return _mm256_shuffle_epi8(v, mask);
+    }
+
+    // ڴ8鲢תΪ״̬
+    SM4_TARGET("avx2")
+    static inline void load8(const unsigned char* p, __m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3) {
+        __m256i d0 = byteSwapAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        __m256i d1 = byteSwapAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)));
+        __m256i d2 = byteSwapAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64)));
+        __m256i d3 = byteSwapAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 96)));
+        transpose_4x8_epi32(d0, d1, d2, d3, x0, x1, x2, x3);
+    }
+
+    // 任תû8ڴ沼֣ڼĴУ
+    SM4_TARGET("avx2")
+    static inline void unload8(const __m256i& x0, const __m256i& x1, const __m256i& x2, const __m256i& x3,
+        __m256i& d0, __m256i& d1, __m256i& d2, __m256i& d3) {
+        transpose_4x8_epi32(x3, x2, x1, x0, d0, d1, d2, d3);
+        d0 = byteSwapAVX2(d0);
+        d1 = byteSwapAVX2(d1);
+        d2 = byteSwapAVX2(d2);
+        d3 = byteSwapAVX2(d3);
+    }
+
+    // Sʵֵĺ󣬹ֺģʹãoperator()ΪT任sboxΪLSУԿչã
+    struct TableSLayer {
+        TableSLayer() {}
+        explicit TableSLayer(const SM4&) {}
+        SM4_TARGET("avx2") inline __m256i operator()(__m256i w) const { return tTransformAVX2(w); }
+        SM4_TARGET("avx2") inline __m256i sbox(__m256i w) const { return sboxAVX2(w); }
+    };
+    struct AesniSLayer {
+        AesniSLayer() {}
+        explicit AesniSLayer(const SM4&) {}
+        SM4_TARGET("avx2,aes") inline __m256i operator()(__m256i w) const { return tTransformAESNI(w); }
+        SM4_TARGET("avx2,aes") inline __m256i sbox(__m256i w) const { return sboxAESNI(w); }
+    };
+    struct GfniSLayer {
+        GfniSLayer() {}
+        explicit GfniSLayer(const SM4&) {}
+        SM4_TARGET("avx2,gfni") inline __m256i operator()(__m256i w) const { return tTransformGFNI(w); }
+        SM4_TARGET("avx2,gfni") inline __m256i sbox(__m256i w) const { return sboxGFNI(w); }
+    };
+
+    // 8·е32ֵ
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static inline void roundLoop8(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3,
+        const unsigned int* rk, const SLayer& t) {
+        for (int round = 0; round < 32; round += 4) {
+            // : X0 ^ T(X1 ^ X2 ^ X3 ^ rk)4չĴ
+            x0 = _mm256_xor_si256(x0, t(_mm256_xor_si256(
+                _mm256_xor_si256(x1, x2), _mm256_xor_si256(x3, _mm256_set1_epi32(rk[round])))));
+            x1 = _mm256_xor_si256(x1, t(_mm256_xor_si256(
+                _mm256_xor_si256(x2, x3), _mm256_xor_si256(x0, _mm256_set1_epi32(rk[round + 1])))));
+            x2 = _mm256_xor_si256(x2, t(_mm256_xor_si256(
+                _mm256_xor_si256(x3, x0), _mm256_xor_si256(x1, _mm256_set1_epi32(rk[round + 2])))));
+            x3 = _mm256_xor_si256(x3, t(_mm256_xor_si256(
+                _mm256_xor_si256(x0, x1), _mm256_xor_si256(x2, _mm256_set1_epi32(rk[round + 3])))));
+        }
+    }
+
+    // 16·е32ֵ8齻ִУز/ָӳ
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static inline void roundLoop16(__m256i& a0, __m256i& a1, __m256i& a2, __m256i& a3,
+        __m256i& b0, __m256i& b1, __m256i& b2, __m256i& b3, const unsigned int* rk, const SLayer& t) {
+        for (int round = 0; round < 32; round += 4) {
+            __m256i k = _mm256_set1_epi32(rk[round]);
+            a0 = _mm256_xor_si256(a0, t(_mm256_xor_si256(_mm256_xor_si256(a1, a2), _mm256_xor_si256(a3, k))));
+            b0 = _mm256_xor_si256(b0, t(_mm256_xor_si256(_mm256_xor_si256(b1, b2), _mm256_xor_si256(b3, k))));
+            k = _mm256_set1_epi32(rk[round + 1]);
+            a1 = _mm256_xor_si256(a1, t(_mm256_xor_si256(_mm256_xor_si256(a2, a3), _mm256_xor_si256(a0, k))));
+            b1 = _mm256_xor_si256(b1, t(_mm256_xor_si256(_mm256_xor_si256(b2, b3), _mm256_xor_si256(b0, k))));
+            k = _mm256_set1_epi32(rk[round + 2]);
+            a2 = _mm256_xor_si256(a2, t(_mm256_xor_si256(_mm256_xor_si256(a3, a0), _mm256_xor_si256(a1, k))));
+            b2 = _mm256_xor_si256(b2, t(_mm256_xor_si256(_mm256_xor_si256(b3, b0), _mm256_xor_si256(b1, k))));
+            k = _mm256_set1_epi32(rk[round + 3]);
+            a3 = _mm256_xor_si256(a3, t(_mm256_xor_si256(_mm256_xor_si256(a0, a1), _mm256_xor_si256(a2, k))));
+            b3 = _mm256_xor_si256(b3, t(_mm256_xor_si256(_mm256_xor_si256(b0, b1), _mm256_xor_si256(b2, k))));
+        }
+    }
+
+    // 8·е32ֵÿͨʹøԵԿrk[i]Ϊi8ͨԿ
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static inline void roundLoop8Keys(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3,
+        const __m256i* rk, const SLayer& t) {
+        for (int round = 0; round < 32; round += 4) {
+            x0 = _mm256_xor_si256(x0, t(_mm256_xor_si256(_mm256_xor_si256(x1, x2), _mm256_xor_si256(x3, rk[round]))));
+            x1 = _mm256_xor_si256(x1, t(_mm256_xor_si256(_mm256_xor_si256(x2, x3), _mm256_xor_si256(x0, rk[round + 1]))));
+            x2 = _mm256_xor_si256(x2, t(_mm256_xor_si256(_mm256_xor_si256(x3, x0), _mm256_xor_si256(x1, rk[round + 2]))));
+            x3 = _mm256_xor_si256(x3, t(_mm256_xor_si256(_mm256_xor_si256(x0, x1), _mm256_xor_si256(x2, rk[round + 3]))));
+        }
+    }
+
+    // 16·СÿͨԿ32ֵ
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static inline void roundLoop16Keys(__m256i& a0, __m256i& a1, __m256i& a2, __m256i& a3,
+        __m256i& b0, __m256i& b1, __m256i& b2, __m256i& b3, const __m256i* rkA, const __m256i* rkB, const SLayer& t) {
+        for (int round = 0; round < 32; round += 4) {
+            a0 = _mm256_xor_si256(a0, t(_mm256_xor_si256(_mm256_xor_si256(a1, a2), _mm256_xor_si256(a3, rkA[round]))));
+            b0 = _mm256_xor_si256(b0, t(_mm256_xor_si256(_mm256_xor_si256(b1, b2), _mm256_xor_si256(b3, rkB[round]))));
+            a1 = _mm256_xor_si256(a1, t(_mm256_xor_si256(_mm256_xor_si256(a2, a3), _mm256_xor_si256(a0, rkA[round + 1]))));
+            b1 = _mm256_xor_si256(b1, t(_mm256_xor_si256(_mm256_xor_si256(b2, b3), _mm256_xor_si256(b0, rkB[round + 1]))));
+            a2 = _mm256_xor_si256(a2, t(_mm256_xor_si256(_mm256_xor_si256(a3, a0), _mm256_xor_si256(a1, rkA[round + 2]))));
+            b2 = _mm256_xor_si256(b2, t(_mm256_xor_si256(_mm256_xor_si256(b3, b0), _mm256_xor_si256(b1, rkB[round + 2]))));
+            a3 = _mm256_xor_si256(a3, t(_mm256_xor_si256(_mm256_xor_si256(a0, a1), _mm256_xor_si256(a2, rkA[round + 3]))));
+            b3 = _mm256_xor_si256(b3, t(_mm256_xor_si256(_mm256_xor_si256(b0, b1), _mm256_xor_si256(b2, rkB[round + 3]))));
+        }
+    }
+
+    // 8x832λ־תã棩r[i]ĵjr[j]ĵiֽ
+    SM4_TARGET("avx2")
+    static inline void transpose_8x8_epi32(__m256i r[8]) {
+        __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+        __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+        __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+        __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+        __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+        __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+        __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+        __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+        __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+        __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+        __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+        r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+    // ת״̬ͨiӦķ
+    static constexpr int LANE_BLOCK[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+
+    // ȡn8ʱԵ0룩ԿתΪÿһͨ˳load8һ£
+    // decryptingʱȡ
+    SM4_TARGET("avx2")
+    static inline void loadScheduleVectors(const SM4KeySchedule* ks, size_t n, bool decrypting, __m256i rk[32]) {
+        const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+        for (int q = 0; q < 4; q++) {
+            __m256i* r = rk + 8 * q;
+            for (int i = 0; i < 8; i++) {
+                const unsigned int* src = ks[static_cast<size_t>(LANE_BLOCK[i]) < n ? LANE_BLOCK[i] : 0].rk;
+                if (decrypting) {
+                    r[i] = _mm256_permutevar8x32_epi32(
+                        _mm256_load_si256(reinterpret_cast<const __m256i*>(src + 24 - 8 * q)), reverse);
+                }
+                else {
+                    r[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(src + 8 * q));
+                }
+            }
+            transpose_8x8_epi32(r);
+        }
     }
 
-    // 16ֽݿ飨ѭչŻ
-    void encrypt(const unsigned char input[16], unsigned char output[16]) {
+    // ÿһԿתûظԿԿֻдǰn
+    SM4_TARGET("avx2")
+    static inline void storeScheduleVectors(__m256i rk[32], SM4KeySchedule* ks, size_t n) {
+        for (int q = 0; q < 4; q++) {
+            __m256i* r = rk + 8 * q;
+            transpose_8x8_epi32(r);
+            for (int i = 0; i < 8; i++) {
+                if (static_cast<size_t>(LANE_BLOCK[i]) < n) {
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(ks[LANE_BLOCK[i]].rk + 8 * q), r[i]);
+                }
+            }
+        }
+    }
+
+    // T'任SкL'(B) = B ^ (B <<< 13) ^ (B <<< 23)
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static inline __m256i tPrimeAVX2(__m256i w, const SLayer& t) {
+        __m256i b = t.sbox(w);
+        return _mm256_xor_si256(b, _mm256_xor_si256(
+            _mm256_or_si256(_mm256_slli_epi32(b, 13), _mm256_srli_epi32(b, 19)),
+            _mm256_or_si256(_mm256_slli_epi32(b, 23), _mm256_srli_epi32(b, 9))));
+    }
+
+    // 128λ˼nctr[0]Ϊ֣
+    static inline void counterAdd(unsigned int ctr[4], unsigned long long n) {
+        unsigned long long sum = static_cast<unsigned long long>(ctr[3]) + (n & 0xFFFFFFFF);
+        ctr[3] = static_cast<unsigned int>(sum);
+        sum = static_cast<unsigned long long>(ctr[2]) + (n >> 32) + (sum >> 32);
+        ctr[2] = static_cast<unsigned int>(sum);
+        sum = static_cast<unsigned long long>(ctr[1]) + (sum >> 32);
+        ctr[1] = static_cast<unsigned int>(sum);
+        ctr[0] += static_cast<unsigned int>(sum >> 32);
+    }
+
+    // ڼĴֱ8ת״̬ǰ8
+    SM4_TARGET("avx2")
+    static inline void makeCounters8(unsigned int ctr[4], __m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3) {
+        if (ctr[3] <= 0xFFFFFFF8u) {
+            // λֲλֲͨͬͨ˳Ϊ0,2,4,6,1,3,5,7
+            x0 = _mm256_set1_epi32(ctr[0]);
+            x1 = _mm256_set1_epi32(ctr[1]);
+            x2 = _mm256_set1_epi32(ctr[2]);
+            x3 = _mm256_add_epi32(_mm256_set1_epi32(ctr[3]), _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+            counterAdd(ctr, 8);
+            return;
+        }
+
+        // λּλ
+        alignas(32) unsigned int w[4][8];
+        static const int lane[8] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+        for (int j = 0; j < 8; j++) {
+            for (int k = 0; k < 4; k++) {
+                w[k][lane[j]] = ctr[k];
+            }
+            counterAdd(ctr, 1);
+        }
+        x0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(w[0]));
+        x1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(w[1]));
+        x2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(w[2]));
+        x3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(w[3]));
+    }
+
+    // 32ֵѭչŻrkΪܻԿ
+    static void cryptBlock(const unsigned char input[16], unsigned char output[16], const unsigned int* rk) {
         // ֳ432λ֣
         unsigned int x0, x1, x2, x3;
         x0 = (input[0] << 24) | (input[1] << 16) | (input[2] << 8) | input[3];
@@ -222,28 +1091,28 @@ public:
         // 32ֵ
         for (int i = 0; i < 32; i += 4) {
             // 1
-            unsigned int temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ roundKeys[i]);
+            unsigned int temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ rk[i]);
             x0 = x1;
             x1 = x2;
             x2 = x3;
             x3 = temp;
 
             // 2
-            temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ roundKeys[i + 1]);
+            temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ rk[i + 1]);
             x0 = x1;
             x1 = x2;
             x2 = x3;
             x3 = temp;
 
             // 3
-            temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ roundKeys[i + 2]);
+            temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ rk[i + 2]);
             x0 = x1;
             x1 = x2;
             x2 = x3;
             x3 = temp;
 
             // 4
-            temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ roundKeys[i + 3]);
+            temp = x0 ^ tTransform(x1 ^ x2 ^ x3 ^ rk[i + 3]);
             x0 = x1;
             x1 = x2;
             x2 = x3;
@@ -266,121 +1135,2816 @@ public:
         output[14] = (y3 >> 8) & 0xFF; output[15] = y3 & 0xFF;
     }
 
-    // 16ֽݿ
-    void decrypt(const unsigned char input[16], unsigned char output[16]) {
-        // ʹԿ
-        array<unsigned int, 32> reverseKeys;
-        for (int i = 0; i < 32; i++) {
-            reverseKeys[i] = roundKeys[31 - i];
+    // תΪ16ֽڴ˷
+    static inline void storeCounter(const unsigned int ctr[4], unsigned char block[16]) {
+        for (int i = 0; i < 4; i++) {
+            block[i * 4] = (ctr[i] >> 24) & 0xFF; block[i * 4 + 1] = (ctr[i] >> 16) & 0xFF;
+            block[i * 4 + 2] = (ctr[i] >> 8) & 0xFF; block[i * 4 + 3] = ctr[i] & 0xFF;
         }
+    }
 
-        // ʱԭʼԿ
-        auto tempKeys = roundKeys;
+    // ==================== ںˣ֧AVX2ʱʹã ====================
 
-        // ʹԿ
-        roundKeys = reverseKeys;
+    static void ecbScalar(const SM4&, const unsigned char* input, unsigned char* output,
+        size_t numBlocks, const unsigned int* rk) {
+        for (size_t i = 0; i < numBlocks; i++) {
+            cryptBlock(input + i * 16, output + i * 16, rk);
+        }
+    }
 
-        // ִм
-        encrypt(input, output);
+    static void ctrScalar(const SM4& c, unsigned int ctr[4], const unsigned char* input,
+        unsigned char* output, size_t len) {
+        unsigned char block[16], stream[16];
+        while (len > 0) {
+            storeCounter(ctr, block);
+            cryptBlock(block, stream, c.roundKeys.data());
+            counterAdd(ctr, 1);
 
-        // ָԭʼԿ
-        roundKeys = tempKeys;
+            size_t n = min(len, static_cast<size_t>(16));
+            for (size_t i = 0; i < n; i++) {
+                output[i] = input[i] ^ stream[i];
+            }
+            input += n;
+            output += n;
+            len -= n;
+        }
     }
 
-    // AVX2м
-    void encryptParallel(const unsigned char* input, unsigned char* output, size_t numBlocks) {
-        // ȷڴ
-        constexpr size_t alignment = 32;
-        if (reinterpret_cast<uintptr_t>(input) % alignment != 0 ||
-            reinterpret_cast<uintptr_t>(output) % alignment != 0) {
-            // ˵д
-            for (size_t i = 0; i < numBlocks; i++) {
-                encrypt(input + i * 16, output + i * 16);
+    static void cbcDecryptScalar(const SM4& c, unsigned char iv[16], const unsigned char* input,
+        unsigned char* output, size_t numBlocks) {
+        unsigned char cipher[16], plain[16];
+        for (size_t i = 0; i < numBlocks; i++) {
+            // ȱķ飬֧ԭؽ
+            memcpy(cipher, input + i * 16, 16);
+            cryptBlock(cipher, plain, c.decRoundKeys.data());
+            for (int j = 0; j < 16; j++) {
+                output[i * 16 + j] = plain[j] ^ iv[j];
             }
-            return;
+            memcpy(iv, cipher, 16);
         }
+    }
 
-        // AVX2дÿδ8飩
-        for (size_t i = 0; i < numBlocks; i += 8) {
-            // 8
-            __m256i data0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + i * 16));
-            __m256i data1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 1) * 16));
-            __m256i data2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 2) * 16));
-            __m256i data3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 3) * 16));
-            __m256i data4 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 4) * 16));
-            __m256i data5 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 5) * 16));
-            __m256i data6 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 6) * 16));
-            __m256i data7 = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + (i + 7) * 16));
+    static void cbcEncrypt8Scalar(const SM4& c, unsigned char iv[8][16], const unsigned char* const input[8],
+        unsigned char* const output[8], const size_t numBlocks[8]) {
+        for (int k = 0; k < 8; k++) {
+            c.cbcEncryptBlocks(iv[k], input[k], output[k], numBlocks[k]);
+        }
+    }
 
-            // ÿ__m256i8ͬλõ״̬
-            __m256i x0, x1, x2, x3;
-            transpose_4x8_epi32(data0, data1, data2, data3, data4, data5, data6, data7, x0, x1, x2, x3);
+    // XTSֵԦGF(2^128)Сֽģx^128+x^7+x^2+x+1
+    static inline void xtsMulAlpha(unsigned char t[16]) {
+        unsigned char carry = t[15] >> 7;
+        for (int i = 15; i > 0; i--) {
+            t[i] = static_cast<unsigned char>((t[i] << 1) | (t[i - 1] >> 7));
+        }
+        t[0] = static_cast<unsigned char>((t[0] << 1) ^ (0x87 & (0 - carry)));
+    }
 
-            // 32ֵ
-            for (int round = 0; round < 32; round++) {
-                __m256i rk = _mm256_set1_epi32(roundKeys[round]);
+    // XTS鴦C = E(P ^ T) ^ TÿTԦútweakΪһĵֵ
+    static void xtsScalar(const SM4&, unsigned char tweak[16], const unsigned char* input,
+        unsigned char* output, size_t numBlocks, const unsigned int* rk) {
+        unsigned char block[16];
+        for (size_t i = 0; i < numBlocks; i++) {
+            for (int j = 0; j < 16; j++) {
+                block[j] = input[i * 16 + j] ^ tweak[j];
+            }
+            cryptBlock(block, block, rk);
+            for (int j = 0; j < 16; j++) {
+                output[i * 16 + j] = block[j] ^ tweak[j];
+            }
+            xtsMulAlpha(tweak);
+        }
+    }
 
-                // : X0 ^ T(X1 ^ X2 ^ X3 ^ rk)
-                __m256i temp = _mm256_xor_si256(x1, x2);
-                temp = _mm256_xor_si256(temp, x3);
-                temp = _mm256_xor_si256(temp, rk);
-                temp = tTransformAVX2(temp);
-                temp = _mm256_xor_si256(x0, temp);
+    static void expandKeysScalar(const unsigned char* keys, SM4KeySchedule* schedules, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            expandKey(keys + i * 16, schedules[i].rk);
+        }
+    }
 
-                // ״̬
-                x0 = x1;
-                x1 = x2;
-                x2 = x3;
-                x3 = temp;
+    static void multiKeyScalar(const SM4KeySchedule* schedules, const unsigned char* input,
+        unsigned char* output, size_t numBlocks, bool decrypting) {
+        unsigned int rk[32];
+        for (size_t i = 0; i < numBlocks; i++) {
+            if (decrypting) {
+                for (int j = 0; j < 32; j++) {
+                    rk[j] = schedules[i].rk[31 - j];
+                }
+                cryptBlock(input + i * 16, output + i * 16, rk);
             }
+            else {
+                cryptBlock(input + i * 16, output + i * 16, schedules[i].rk);
+            }
+        }
+    }
 
-            // 任
-            __m256i y0 = x3, y1 = x2, y2 = x1, y3 = x0;
+    // ==================== AVX2ںˣSʵ ====================
 
-            // תûԭʼ
-            transpose_4x8_epi32(y0, y1, y2, y3, data0, data1, data2, data3, data4, data5, data6, data7);
+    // 8β뵽8һSIMD
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void cryptTail8(const unsigned char* input, unsigned char* output, size_t numBlocks,
+        const unsigned int* rk, const SLayer& t) {
+        alignas(32) unsigned char buf[128] = { 0 };
+        memcpy(buf, input, numBlocks * 16);
 
-            // 洢
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + i * 16), data0);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 1) * 16), data1);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 2) * 16), data2);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 3) * 16), data3);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 4) * 16), data4);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 5) * 16), data5);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 6) * 16), data6);
-            _mm256_store_si256(reinterpret_cast<__m256i*>(output + (i + 7) * 16), data7);
-        }
+        __m256i x0, x1, x2, x3;
+        load8(buf, x0, x1, x2, x3);
+        roundLoop8(x0, x1, x2, x3, rk, t);
 
-        // ʣ
-        size_t processed = (numBlocks / 8) * 8;
-        for (size_t i = processed; i < numBlocks; i++) {
-            encrypt(input + i * 16, output + i * 16);
-        }
+        __m256i d0, d1, d2, d3;
+        unload8(x0, x1, x2, x3, d0, d1, d2, d3);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buf), d0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buf + 32), d1);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buf + 64), d2);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buf + 96), d3);
+        memcpy(output, buf, numBlocks * 16);
     }
 
-};
+    // ECBдÿ16/8AVX2·Ƕ/洢
+    // 8鲹һSIMD˵
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void ecbKernel(const SM4& c, const unsigned char* input, unsigned char* output,
+        size_t numBlocks, const unsigned int* rk) {
+        const SLayer t(c);
+        size_t i = 0;
+        for (; i + 16 <= numBlocks; i += 16) {
+            __m256i a0, a1, a2, a3, b0, b1, b2, b3;
+            load8(input + i * 16, a0, a1, a2, a3);
+            load8(input + i * 16 + 128, b0, b1, b2, b3);
 
+            roundLoop16(a0, a1, a2, a3, b0, b1, b2, b3, rk, t);
 
-// 
-int main() {
+            __m256i d[8];
+            unload8(a0, a1, a2, a3, d[0], d[1], d[2], d[3]);
+            unload8(b0, b1, b2, b3, d[4], d[5], d[6], d[7]);
+            __m256i* out = reinterpret_cast<__m256i*>(output + i * 16);
+            for (int k = 0; k < 8; k++) {
+                _mm256_storeu_si256(out + k, d[k]);
+            }
+        }
 
-    unsigned char key[16] = {
-        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
-        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF
-    };
+        for (; i + 8 <= numBlocks; i += 8) {
+            // 8飬ÿ__m256i8ͬλõ״̬
+            __m256i x0, x1, x2, x3;
+            load8(input + i * 16, x0, x1, x2, x3);
 
-    unsigned char plaintext[16] = {
-        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
-        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF
-    };
+            // 32ֵ
+            roundLoop8(x0, x1, x2, x3, rk, t);
 
-    unsigned char ciphertext[16];
-    unsigned char decrypted[16];
+            // 任תûԭʼ
+            __m256i d[4];
+            unload8(x0, x1, x2, x3, d[0], d[1], d[2], d[3]);
+            __m256i* out = reinterpret_cast<__m256i*>(output + i * 16);
+            for (int k = 0; k < 4; k++) {
+                _mm256_storeu_si256(out + k, d[k]);
+            }
+        }
 
-    SM4 sm4(key);
+        if (i < numBlocks) {
+            cryptTail8(input + i * 16, output + i * 16, numBlocks - i, rk, t);
+        }
+    }
 
-    cout << "ԭʼ: ";
-    for (int i = 0; i < 16; i++) {
+    // CTRctrӦķ߽翪ʼlenֽڣúctrֵʹã
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void ctrKernel(const SM4& c, unsigned int ctr[4], const unsigned char* input,
+        unsigned char* output, size_t len) {
+        const SLayer t(c);
+        alignas(32) unsigned char stream[128];
+        while (len > 0) {
+            // ڼĴ8鲢ܵõԿ
+            __m256i x0, x1, x2, x3;
+            makeCounters8(ctr, x0, x1, x2, x3);
+            roundLoop8(x0, x1, x2, x3, c.roundKeys.data(), t);
+
+            __m256i k0, k1, k2, k3;
+            unload8(x0, x1, x2, x3, k0, k1, k2, k3);
+
+            if (len >= 128) {
+                // Կֱд
+                const __m256i* in = reinterpret_cast<const __m256i*>(input);
+                __m256i* out = reinterpret_cast<__m256i*>(output);
+                _mm256_storeu_si256(out, _mm256_xor_si256(k0, _mm256_loadu_si256(in)));
+                _mm256_storeu_si256(out + 1, _mm256_xor_si256(k1, _mm256_loadu_si256(in + 1)));
+                _mm256_storeu_si256(out + 2, _mm256_xor_si256(k2, _mm256_loadu_si256(in + 2)));
+                _mm256_storeu_si256(out + 3, _mm256_xor_si256(k3, _mm256_loadu_si256(in + 3)));
+                input += 128;
+                output += 128;
+                len -= 128;
+            }
+            else {
+                // β8飺ʹԿֽ
+                _mm256_store_si256(reinterpret_cast<__m256i*>(stream), k0);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(stream + 32), k1);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(stream + 64), k2);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(stream + 96), k3);
+                for (size_t i = 0; i < len; i++) {
+                    output[i] = input[i] ^ stream[i];
+                }
+                len = 0;
+            }
+        }
+    }
+
+    // 8·CBC֯ܣÿ·ռһSIMDֵͨתʽڼĴ
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void cbcEncrypt8Kernel(const SM4& c, unsigned char iv[8][16], const unsigned char* const input[8],
+        unsigned char* const output[8], const size_t numBlocks[8]) {
+        const SLayer t(c);
+        size_t maxBlocks = 0;
+        for (int k = 0; k < 8; k++) {
+            maxBlocks = max(maxBlocks, numBlocks[k]);
+        }
+
+        // ͨ˳Ϊ0,2,4,6,1,3,5,7transpose_4x8_epi32һ
+        __m256i c0, c1, c2, c3;
+        load8(iv[0], c0, c1, c2, c3);
+
+        static const unsigned char zero[16] = { 0 };
+        for (size_t j = 0; j < maxBlocks; j++) {
+            // ÿ·ȡjķ飬ѽռλ
+            const unsigned char* p[8];
+            for (int k = 0; k < 8; k++) {
+                p[k] = (j < numBlocks[k]) ? input[k] + j * 16 : zero;
+            }
+            __m256i d0 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[0]))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[1])), 1);
+            __m256i d1 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[2]))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[3])), 1);
+            __m256i d2 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[4]))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[5])), 1);
+            __m256i d3 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[6]))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p[7])), 1);
+
+            __m256i x0, x1, x2, x3;
+            transpose_4x8_epi32(byteSwapAVX2(d0), byteSwapAVX2(d1), byteSwapAVX2(d2), byteSwapAVX2(d3),
+                x0, x1, x2, x3);
+            x0 = _mm256_xor_si256(x0, c0);
+            x1 = _mm256_xor_si256(x1, c1);
+            x2 = _mm256_xor_si256(x2, c2);
+            x3 = _mm256_xor_si256(x3, c3);
+
+            roundLoop8(x0, x1, x2, x3, c.roundKeys.data(), t);
+
+            // ļһֵ任
+            c0 = x3;
+            c1 = x2;
+            c2 = x1;
+            c3 = x0;
+
+            unload8(x0, x1, x2, x3, d0, d1, d2, d3);
+            __m128i out[8] = {
+                _mm256_castsi256_si128(d0), _mm256_extracti128_si256(d0, 1),
+                _mm256_castsi256_si128(d1), _mm256_extracti128_si256(d1, 1),
+                _mm256_castsi256_si128(d2), _mm256_extracti128_si256(d2, 1),
+                _mm256_castsi256_si128(d3), _mm256_extracti128_si256(d3, 1)
+            };
+            for (int k = 0; k < 8; k++) {
+                if (j < numBlocks[k]) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output[k] + j * 16), out[k]);
+                    if (j + 1 == numBlocks[k]) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(iv[k]), out[k]);
+                    }
+                }
+            }
+        }
+    }
+
+
+    // CBCܣÿ16/8AVX2·β
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void cbcDecryptKernel(const SM4& c, unsigned char iv[16], const unsigned char* input,
+        unsigned char* output, size_t numBlocks) {
+        const SLayer t(c);
+        __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+        size_t i = 0;
+
+        for (; i + 16 <= numBlocks; i += 16) {
+            const unsigned char* in = input + i * 16;
+            __m256i a0, a1, a2, a3, b0, b1, b2, b3;
+            load8(in, a0, a1, a2, a3);
+            load8(in + 128, b0, b1, b2, b3);
+
+            // дǰȡÿǰһķ
+            __m256i p[8];
+            p[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(last),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), 1);
+            for (int k = 1; k < 8; k++) {
+                p[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32 * k - 16));
+            }
+            last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 240));
+
+            roundLoop16(a0, a1, a2, a3, b0, b1, b2, b3, c.decRoundKeys.data(), t);
+
+            __m256i d[8];
+            unload8(a0, a1, a2, a3, d[0], d[1], d[2], d[3]);
+            unload8(b0, b1, b2, b3, d[4], d[5], d[6], d[7]);
+            __m256i* out = reinterpret_cast<__m256i*>(output + i * 16);
+            for (int k = 0; k < 8; k++) {
+                _mm256_storeu_si256(out + k, _mm256_xor_si256(d[k], p[k]));
+            }
+        }
+
+        for (; i + 8 <= numBlocks; i += 8) {
+            const unsigned char* in = input + i * 16;
+            __m256i x0, x1, x2, x3;
+            load8(in, x0, x1, x2, x3);
+
+            __m256i p[4];
+            p[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(last),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), 1);
+            for (int k = 1; k < 4; k++) {
+                p[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32 * k - 16));
+            }
+            last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 112));
+
+            roundLoop8(x0, x1, x2, x3, c.decRoundKeys.data(), t);
+
+            __m256i d[4];
+            unload8(x0, x1, x2, x3, d[0], d[1], d[2], d[3]);
+            __m256i* out = reinterpret_cast<__m256i*>(output + i * 16);
+            for (int k = 0; k < 4; k++) {
+                _mm256_storeu_si256(out + k, _mm256_xor_si256(d[k], p[k]));
+            }
+        }
+
+        // ʣ಻8
+        size_t rest = numBlocks - i;
+        if (rest > 0) {
+            alignas(16) unsigned char cipher[128];
+            alignas(16) unsigned char plain[128];
+            memcpy(cipher, input + i * 16, rest * 16);
+            cryptTail8(cipher, plain, rest, c.decRoundKeys.data(), t);
+            for (size_t k = 0; k < rest; k++) {
+                __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(cipher + k * 16));
+                __m128i m = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(plain + k * 16)), last);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + (i + k) * 16), m);
+                last = c;
+            }
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), last);
+    }
+
+    // XTSֵԦ^k0 <= k <= 8ÿ128λͨʹøԵk64λԪͬ
+    // 64λkλոλkس0x8764λյ64λƳıأ
+    // ǰһֵ8ĵֵͬһTһ
+    SM4_TARGET("avx2")
+    static inline __m256i xtsMulAlphaPow(__m256i t, __m256i k) {
+        __m256i shifted = _mm256_sllv_epi64(t, k);
+        // ƳıأkΪ0ʱλ64λ0ͨڵ64λԪ
+        __m256i carry = _mm256_srlv_epi64(t, _mm256_sub_epi64(_mm256_set1_epi64x(64), k));
+        carry = _mm256_shuffle_epi32(carry, 0x4E);
+        // x^7+x^2+x+1k <= 8ʱ15λ
+        __m256i reduced = _mm256_xor_si256(_mm256_xor_si256(carry, _mm256_slli_epi64(carry, 1)),
+            _mm256_xor_si256(_mm256_slli_epi64(carry, 2), _mm256_slli_epi64(carry, 7)));
+        return _mm256_xor_si256(shifted, _mm256_blend_epi32(reduced, carry, 0xCC));
+    }
+
+    // TT^0..T^7˳ÿĴֵ
+    SM4_TARGET("avx2")
+    static inline void xtsTweaks8(__m256i t, __m256i tw[4]) {
+        tw[0] = xtsMulAlphaPow(t, _mm256_setr_epi64x(0, 0, 1, 1));
+        tw[1] = xtsMulAlphaPow(t, _mm256_setr_epi64x(2, 2, 3, 3));
+        tw[2] = xtsMulAlphaPow(t, _mm256_setr_epi64x(4, 4, 5, 5));
+        tw[3] = xtsMulAlphaPow(t, _mm256_setr_epi64x(6, 6, 7, 7));
+    }
+
+    // ֵתΪ״̬
+    SM4_TARGET("avx2")
+    static inline void xtsLoad8(const unsigned char* p, const __m256i tw[4],
+        __m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3) {
+        __m256i d[4];
+        for (int k = 0; k < 4; k++) {
+            d[k] = byteSwapAVX2(_mm256_xor_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k)), tw[k]));
+        }
+        transpose_4x8_epi32(d[0], d[1], d[2], d[3], x0, x1, x2, x3);
+    }
+
+    // 任תûط鲼ֲٴֵд
+    SM4_TARGET("avx2")
+    static inline void xtsStore8(unsigned char* p, const __m256i tw[4],
+        const __m256i& x0, const __m256i& x1, const __m256i& x2, const __m256i& x3) {
+        __m256i d[4];
+        unload8(x0, x1, x2, x3, d[0], d[1], d[2], d[3]);
+        for (int k = 0; k < 4; k++) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 32 * k), _mm256_xor_si256(d[k], tw[k]));
+        }
+    }
+
+    // XTS鴦ֵSIMDλɣ16/8·ת·β뵽8
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void xtsKernel(const SM4& c, unsigned char tweak[16], const unsigned char* input,
+        unsigned char* output, size_t numBlocks, const unsigned int* rk) {
+        const SLayer t(c);
+        const __m256i eight = _mm256_set1_epi64x(8);
+        __m256i base = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tweak)));
+        size_t i = 0;
+
+        for (; i + 16 <= numBlocks; i += 16) {
+            __m256i twA[4], twB[4];
+            xtsTweaks8(base, twA);
+            base = xtsMulAlphaPow(base, eight);
+            xtsTweaks8(base, twB);
+            base = xtsMulAlphaPow(base, eight);
+
+            __m256i a0, a1, a2, a3, b0, b1, b2, b3;
+            xtsLoad8(input + i * 16, twA, a0, a1, a2, a3);
+            xtsLoad8(input + i * 16 + 128, twB, b0, b1, b2, b3);
+            roundLoop16(a0, a1, a2, a3, b0, b1, b2, b3, rk, t);
+            xtsStore8(output + i * 16, twA, a0, a1, a2, a3);
+            xtsStore8(output + i * 16 + 128, twB, b0, b1, b2, b3);
+        }
+
+        for (; i + 8 <= numBlocks; i += 8) {
+            __m256i tw[4];
+            xtsTweaks8(base, tw);
+            base = xtsMulAlphaPow(base, eight);
+
+            __m256i x0, x1, x2, x3;
+            xtsLoad8(input + i * 16, tw, x0, x1, x2, x3);
+            roundLoop8(x0, x1, x2, x3, rk, t);
+            xtsStore8(output + i * 16, tw, x0, x1, x2, x3);
+        }
+
+        size_t rest = numBlocks - i;
+        if (rest > 0) {
+            __m256i tw[4];
+            xtsTweaks8(base, tw);
+            base = xtsMulAlphaPow(base, _mm256_set1_epi64x(static_cast<long long>(rest)));
+
+            alignas(32) unsigned char buf[128] = { 0 };
+            memcpy(buf, input + i * 16, rest * 16);
+            __m256i x0, x1, x2, x3;
+            xtsLoad8(buf, tw, x0, x1, x2, x3);
+            roundLoop8(x0, x1, x2, x3, rk, t);
+            xtsStore8(buf, tw, x0, x1, x2, x3);
+            memcpy(output + i * 16, buf, rest * 16);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(tweak), _mm256_castsi256_si128(base));
+    }
+
+    // 8ԿΪ״̬֣ͬתò֣FK
+    SM4_TARGET("avx2")
+    static inline void loadKeys8(const unsigned char* keys, __m256i k[4]) {
+        load8(keys, k[0], k[1], k[2], k[3]);
+        for (int i = 0; i < 4; i++) {
+            k[i] = _mm256_xor_si256(k[i], _mm256_set1_epi32(static_cast<int>(FK[i])));
+        }
+    }
+
+    // ԿչÿͨһԿ32T'ֺͬ
+    // ÿ8ԿչSӳ٣ʣಿְ8һ飨β㣩
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void expandKeysKernel(const unsigned char* keys, SM4KeySchedule* schedules, size_t count) {
+        const SLayer t;
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i a[36], b[36];
+            loadKeys8(keys + i * 16, a);
+            loadKeys8(keys + i * 16 + 128, b);
+            for (int r = 0; r < 32; r++) {
+                __m256i ck = _mm256_set1_epi32(static_cast<int>(CK[r]));
+                a[r + 4] = _mm256_xor_si256(a[r], tPrimeAVX2(_mm256_xor_si256(
+                    _mm256_xor_si256(a[r + 1], a[r + 2]), _mm256_xor_si256(a[r + 3], ck)), t));
+                b[r + 4] = _mm256_xor_si256(b[r], tPrimeAVX2(_mm256_xor_si256(
+                    _mm256_xor_si256(b[r + 1], b[r + 2]), _mm256_xor_si256(b[r + 3], ck)), t));
+            }
+            storeScheduleVectors(a + 4, schedules + i, 8);
+            storeScheduleVectors(b + 4, schedules + i + 8, 8);
+        }
+
+        while (i < count) {
+            size_t n = min(static_cast<size_t>(8), count - i);
+            alignas(32) unsigned char buf[128] = { 0 };
+            const unsigned char* src = keys + i * 16;
+            if (n < 8) {
+                memcpy(buf, src, n * 16);
+                src = buf;
+            }
+            __m256i a[36];
+            loadKeys8(src, a);
+            for (int r = 0; r < 32; r++) {
+                a[r + 4] = _mm256_xor_si256(a[r], tPrimeAVX2(_mm256_xor_si256(_mm256_xor_si256(a[r + 1], a[r + 2]),
+                    _mm256_xor_si256(a[r + 3], _mm256_set1_epi32(static_cast<int>(CK[r])))), t));
+            }
+            storeScheduleVectors(a + 4, schedules + i, n);
+            i += n;
+        }
+    }
+
+    // ԿECBiʹschedules[i]ԿתΪÿһ16/8·ֺ
+    template <typename SLayer>
+    SM4_TARGET("avx2")
+    static void multiKeyKernel(const SM4KeySchedule* schedules, const unsigned char* input,
+        unsigned char* output, size_t numBlocks, bool decrypting) {
+        const SLayer t;
+        __m256i rkA[32], rkB[32];
+        size_t i = 0;
+        for (; i + 16 <= numBlocks; i += 16) {
+            loadScheduleVectors(schedules + i, 8, decrypting, rkA);
+            loadScheduleVectors(schedules + i + 8, 8, decrypting, rkB);
+
+            __m256i a0, a1, a2, a3, b0, b1, b2, b3;
+            load8(input + i * 16, a0, a1, a2, a3);
+            load8(input + i * 16 + 128, b0, b1, b2, b3);
+            roundLoop16Keys(a0, a1, a2, a3, b0, b1, b2, b3, rkA, rkB, t);
+
+            __m256i d[8];
+            unload8(a0, a1, a2, a3, d[0], d[1], d[2], d[3]);
+            unload8(b0, b1, b2, b3, d[4], d[5], d[6], d[7]);
+            __m256i* out = reinterpret_cast<__m256i*>(output + i * 16);
+            for (int k = 0; k < 8; k++) {
+                _mm256_storeu_si256(out + k, d[k]);
+            }
+        }
+
+        // ʣಿְ8һ飬β鲢ԵһԿռλ
+        while (i < numBlocks) {
+            size_t n = min(static_cast<size_t>(8), numBlocks - i);
+            loadScheduleVectors(schedules + i, n, decrypting, rkA);
+
+            alignas(32) unsigned char buf[128] = { 0 };
+            memcpy(buf, input + i * 16, n * 16);
+            __m256i x0, x1, x2, x3;
+            load8(buf, x0, x1, x2, x3);
+            roundLoop8Keys(x0, x1, x2, x3, rkA, t);
+
+            __m256i d[4];
+            unload8(x0, x1, x2, x3, d[0], d[1], d[2], d[3]);
+            for (int k = 0; k < 4; k++) {
+                _mm256_store_si256(reinterpret_cast<__m256i*>(buf + 32 * k), d[k]);
+            }
+            memcpy(output + i * 16, buf, n * 16);
+            i += n;
+        }
+    }
+
+
+    // SںʵչʹSڶӦָ
+#define SM4_SIMD_KERNELS(SUFFIX, FEATURES, SLAYER) \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void ecb##SUFFIX(const SM4& c, const unsigned char* input, unsigned char* output, \
+        size_t numBlocks, const unsigned int* rk) { \
+        ecbKernel<SLAYER>(c, input, output, numBlocks, rk); \
+    } \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void ctr##SUFFIX(const SM4& c, unsigned int ctr[4], const unsigned char* input, \
+        unsigned char* output, size_t len) { \
+        ctrKernel<SLAYER>(c, ctr, input, output, len); \
+    } \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void cbcDecrypt##SUFFIX(const SM4& c, unsigned char iv[16], const unsigned char* input, \
+        unsigned char* output, size_t numBlocks) { \
+        cbcDecryptKernel<SLAYER>(c, iv, input, output, numBlocks); \
+    } \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void cbcEncrypt8##SUFFIX(const SM4& c, unsigned char iv[8][16], const unsigned char* const input[8], \
+        unsigned char* const output[8], const size_t numBlocks[8]) { \
+        cbcEncrypt8Kernel<SLAYER>(c, iv, input, output, numBlocks); \
+    } \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void xts##SUFFIX(const SM4& c, unsigned char tweak[16], const unsigned char* input, \
+        unsigned char* output, size_t numBlocks, const unsigned int* rk) { \
+        xtsKernel<SLAYER>(c, tweak, input, output, numBlocks, rk); \
+    } \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void expandKeys##SUFFIX(const unsigned char* keys, SM4KeySchedule* schedules, size_t count) { \
+        expandKeysKernel<SLAYER>(keys, schedules, count); \
+    } \
+    SM4_TARGET(FEATURES) SM4_FLATTEN \
+    static void multiKey##SUFFIX(const SM4KeySchedule* schedules, const unsigned char* input, \
+        unsigned char* output, size_t numBlocks, bool decrypting) { \
+        multiKeyKernel<SLAYER>(schedules, input, output, numBlocks, decrypting); \
+    }
+
+    SM4_SIMD_KERNELS(AVX2, "avx2", TableSLayer)
+    SM4_SIMD_KERNELS(AESNI, "avx2,aes", AesniSLayer)
+    SM4_SIMD_KERNELS(GFNI, "avx2,gfni", GfniSLayer)
+#undef SM4_SIMD_KERNELS
+
+    // ==================== λƬʵ֣ʱ䣩 ====================
+    // ÿλƽ汣һͬһλõֵuint64_tӦ64飬
+    // __m256iӦ256飬__m512iӦ512顣SԲ·㣬
+    // ûݵĲͷ֧
+
+    // SеĴṹS(x) = AI(Ax + 0xD3) + 0xD3IΪģx^8+x^7+x^6+x^5+x^4+x^2+1
+    // ڸGF((2^4)^2)ɣGF(2^4)ģz^4+z+1ģY^2+Y+z^3
+    // /任Ѻϲ任Aͬӳ䣬Ӧľ󣨵iΪiλλ룩Ϊ
+    //   룺{ 0xD8, 0x65, 0xBE, 0xE3, 0x93, 0x40, 0xC4, 0x7F } + 0xAC
+    //   { 0x93, 0x45, 0xE4, 0x95, 0x1A, 0xBA, 0x57, 0x19 } + 0xD3
+
+    // λƽͣÿ64Ϊһ飬GROUPSΪһλƽ
+    struct BitPlane64 {
+        typedef uint64_t V;
+        static const int GROUPS = 1;
+        static inline V XOR(V a, V b) { return a ^ b; }
+        static inline V AND(V a, V b) { return a & b; }
+        static inline V NOT(V a) { return ~a; }
+        static inline V fill(uint64_t bits) { return bits; }
+        static inline V shr(V a, int n) { return a >> n; }
+        static inline V shl(V a, int n) { return a << n; }
+        static inline V pack(const uint64_t* w) { return w[0]; }
+        static inline void unpack(V v, uint64_t* w) { w[0] = v; }
+    };
+
+    struct BitPlaneAVX2 {
+        typedef __m256i V;
+        static const int GROUPS = 4;
+        SM4_TARGET("avx2") static inline V XOR(V a, V b) { return _mm256_xor_si256(a, b); }
+        SM4_TARGET("avx2") static inline V AND(V a, V b) { return _mm256_and_si256(a, b); }
+        SM4_TARGET("avx2") static inline V NOT(V a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+        SM4_TARGET("avx2") static inline V fill(uint64_t bits) { return _mm256_set1_epi64x(static_cast<long long>(bits)); }
+        SM4_TARGET("avx2") static inline V shr(V a, int n) { return _mm256_srli_epi64(a, n); }
+        SM4_TARGET("avx2") static inline V shl(V a, int n) { return _mm256_slli_epi64(a, n); }
+        SM4_TARGET("avx2") static inline V pack(const uint64_t* w) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w)); }
+        SM4_TARGET("avx2") static inline void unpack(V v, uint64_t* w) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(w), v); }
+    };
+
+#if defined(__GNUC__) && !defined(__clang__)
+    // GCC 12avx512fintrin.h64λλδʼ__Yֱֵͨ
+    // -Wmaybe-uninitialized󱨣GCC bug 105593ڴ˴
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+    struct BitPlaneAVX512 {
+        typedef __m512i V;
+        static const int GROUPS = 8;
+        SM4_TARGET("avx512f") static inline V XOR(V a, V b) { return _mm512_xor_si512(a, b); }
+        SM4_TARGET("avx512f") static inline V AND(V a, V b) { return _mm512_and_si512(a, b); }
+        SM4_TARGET("avx512f") static inline V NOT(V a) { return _mm512_xor_si512(a, _mm512_set1_epi32(-1)); }
+        SM4_TARGET("avx512f") static inline V fill(uint64_t bits) { return _mm512_set1_epi64(static_cast<long long>(bits)); }
+        SM4_TARGET("avx512f") static inline V shr(V a, int n) { return _mm512_srli_epi64(a, n); }
+        SM4_TARGET("avx512f") static inline V shl(V a, int n) { return _mm512_slli_epi64(a, n); }
+        SM4_TARGET("avx512f") static inline V pack(const uint64_t* w) { return _mm512_loadu_si512(w); }
+        SM4_TARGET("avx512f") static inline void unpack(V v, uint64_t* w) { _mm512_storeu_si512(w, v); }
+    };
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+    // 64x64ؾתãa[j]ĵiλ <- ԭa[i]ĵjλ棩
+    // λƽ64λͨͬʱתãֱӾλƽ
+    template <typename P>
+    static SM4_INLINE void bsTranspose64(typename P::V a[64]) {
+        uint64_t m = 0x00000000FFFFFFFFull;
+        for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+            typename P::V mask = P::fill(m);
+            for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+                typename P::V t = P::AND(P::XOR(P::shr(a[k], j), a[k | j]), mask);
+                a[k | j] = P::XOR(a[k | j], t);
+                a[k] = P::XOR(a[k], P::shl(t, j));
+            }
+        }
+    }
+
+    // GF(2^4)˷ģz^4+z+1a[0]Ϊλ
+    template <typename P>
+    static SM4_INLINE void bsMul4(const typename P::V a[4], const typename P::V b[4], typename P::V r[4]) {
+        typedef typename P::V V;
+        V c0 = P::AND(a[0], b[0]);
+        V c1 = P::XOR(P::AND(a[0], b[1]), P::AND(a[1], b[0]));
+        V c2 = P::XOR(P::XOR(P::AND(a[0], b[2]), P::AND(a[1], b[1])), P::AND(a[2], b[0]));
+        V c3 = P::XOR(P::XOR(P::AND(a[0], b[3]), P::AND(a[1], b[2])), P::XOR(P::AND(a[2], b[1]), P::AND(a[3], b[0])));
+        V c4 = P::XOR(P::XOR(P::AND(a[1], b[3]), P::AND(a[2], b[2])), P::AND(a[3], b[1]));
+        V c5 = P::XOR(P::AND(a[2], b[3]), P::AND(a[3], b[2]));
+        V c6 = P::AND(a[3], b[3]);
+
+        // z^4 = z + 1, z^5 = z^2 + z, z^6 = z^3 + z^2
+        r[0] = P::XOR(c0, c4);
+        r[1] = P::XOR(P::XOR(c1, c4), c5);
+        r[2] = P::XOR(P::XOR(c2, c5), c6);
+        r[3] = P::XOR(c3, c6);
+    }
+
+    // GF(2^4)ƽԣ
+    template <typename P>
+    static SM4_INLINE void bsSquare4(const typename P::V a[4], typename P::V r[4]) {
+        r[0] = P::XOR(a[0], a[2]);
+        r[1] = a[2];
+        r[2] = P::XOR(a[1], a[3]);
+        r[3] = a[3];
+    }
+
+    // GF(2^4)棺a^14 = a^2  a^4  a^80ӳ䵽0
+    template <typename P>
+    static SM4_INLINE void bsInv4(const typename P::V a[4], typename P::V r[4]) {
+        typename P::V a2[4], a4[4], a8[4], t[4];
+        bsSquare4<P>(a, a2);
+        bsSquare4<P>(a2, a4);
+        bsSquare4<P>(a4, a8);
+        bsMul4<P>(a2, a4, t);
+        bsMul4<P>(t, a8, r);
+    }
+
+    // λƬSУx[0..7]Ϊһֽڵ8λƽ棨x[0]Ϊλԭ滻
+    template <typename P>
+    static SM4_INLINE void bsSbox(typename P::V x[8]) {
+        typedef typename P::V V;
+        // 任
+        V t[8];
+        t[0] = P::XOR(P::XOR(P::XOR(x[3], x[4]), x[6]), x[7]);
+        t[1] = P::XOR(P::XOR(P::XOR(x[0], x[2]), x[5]), x[6]);
+        t[2] = P::NOT(P::XOR(P::XOR(P::XOR(P::XOR(P::XOR(x[1], x[2]), x[3]), x[4]), x[5]), x[7]));
+        t[3] = P::NOT(P::XOR(P::XOR(P::XOR(P::XOR(x[0], x[1]), x[5]), x[6]), x[7]));
+        t[4] = P::XOR(P::XOR(P::XOR(x[0], x[1]), x[4]), x[7]);
+        t[5] = P::NOT(x[6]);
+        t[6] = P::XOR(P::XOR(x[2], x[6]), x[7]);
+        t[7] = P::NOT(P::XOR(P::XOR(P::XOR(P::XOR(P::XOR(P::XOR(x[0], x[1]), x[2]), x[3]), x[4]), x[5]), x[6]));
+
+        // 棺(hY + l)^-1 = (hd^-1)Y + (h + l)d^-1d = z^3h^2 + hl + l^2
+        const V* l = t;
+        const V* h = t + 4;
+        V hl[4], hh[4], ll[4], d[4], dInv[4], sum[4], u[8];
+        bsMul4<P>(h, l, hl);
+        bsSquare4<P>(h, hh);
+        bsSquare4<P>(l, ll);
+        // Գz^3
+        d[0] = P::XOR(P::XOR(hh[1], hl[0]), ll[0]);
+        d[1] = P::XOR(P::XOR(P::XOR(hh[1], hh[2]), hl[1]), ll[1]);
+        d[2] = P::XOR(P::XOR(P::XOR(hh[2], hh[3]), hl[2]), ll[2]);
+        d[3] = P::XOR(P::XOR(P::XOR(hh[0], hh[3]), hl[3]), ll[3]);
+        bsInv4<P>(d, dInv);
+        for (int i = 0; i < 4; i++) {
+            sum[i] = P::XOR(h[i], l[i]);
+        }
+        bsMul4<P>(sum, dInv, u);
+        bsMul4<P>(h, dInv, u + 4);
+
+        // 任
+        x[0] = P::NOT(P::XOR(P::XOR(P::XOR(u[0], u[1]), u[4]), u[7]));
+        x[1] = P::NOT(P::XOR(P::XOR(u[0], u[2]), u[6]));
+        x[2] = P::XOR(P::XOR(P::XOR(u[2], u[5]), u[6]), u[7]);
+        x[3] = P::XOR(P::XOR(P::XOR(u[0], u[2]), u[4]), u[7]);
+        x[4] = P::NOT(P::XOR(P::XOR(u[1], u[3]), u[4]));
+        x[5] = P::XOR(P::XOR(P::XOR(P::XOR(u[1], u[3]), u[4]), u[5]), u[7]);
+        x[6] = P::NOT(P::XOR(P::XOR(P::XOR(P::XOR(u[0], u[1]), u[2]), u[4]), u[6]));
+        x[7] = P::NOT(P::XOR(P::XOR(u[0], u[3]), u[4]));
+    }
+
+    // λƬ32ֵһδ64 * P::GROUPS
+    template <typename P>
+    static SM4_INLINE void cryptBitsliced(const unsigned char* input, unsigned char* output, const unsigned int* rk) {
+        typedef typename P::V V;
+        // תΪλƽ棺x[k][b]Ϊkֵĵbλ
+        // ÿΪһ֣32λΪǰһ֣ÿ64
+        V x[4][32];
+        V rows[64];
+        uint64_t w[P::GROUPS];
+        for (int half = 0; half < 2; half++) {
+            for (int i = 0; i < 64; i++) {
+                for (int g = 0; g < P::GROUPS; g++) {
+                    const unsigned char* p = input + (g * 64 + i) * 16 + half * 8;
+                    uint64_t lo = (static_cast<unsigned int>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+                    uint64_t hi = (static_cast<unsigned int>(p[4]) << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+                    w[g] = lo | (hi << 32);
+                }
+                rows[i] = P::pack(w);
+            }
+            bsTranspose64<P>(rows);
+            for (int b = 0; b < 32; b++) {
+                x[half * 2][b] = rows[b];
+                x[half * 2 + 1][b] = rows[32 + b];
+            }
+        }
+
+        // 32ֵֺֻ״ֱ̬
+        for (int round = 0; round < 32; round++) {
+            V* x0 = x[round & 3];
+            const V* x1 = x[(round + 1) & 3];
+            const V* x2 = x[(round + 2) & 3];
+            const V* x3 = x[(round + 3) & 3];
+
+            V t[32];
+            for (int b = 0; b < 32; b++) {
+                // ԿλչΪȫ0ȫ1Կķ֧
+                V k = P::fill(0 - static_cast<uint64_t>((rk[round] >> b) & 1));
+                t[b] = P::XOR(P::XOR(x1[b], x2[b]), P::XOR(x3[b], k));
+            }
+            for (int j = 0; j < 4; j++) {
+                bsSbox<P>(t + j * 8);
+            }
+
+            // Ա任LѭλƬʾֻƽ±ֻ
+            for (int b = 0; b < 32; b++) {
+                V l = P::XOR(P::XOR(t[b], t[(b + 30) & 31]), t[(b + 22) & 31]);
+                l = P::XOR(P::XOR(l, t[(b + 14) & 31]), t[(b + 8) & 31]);
+                x0[b] = P::XOR(x0[b], l);
+            }
+        }
+
+        // 任תûط鲼
+        for (int half = 0; half < 2; half++) {
+            for (int b = 0; b < 32; b++) {
+                rows[b] = x[3 - half * 2][b];
+                rows[32 + b] = x[2 - half * 2][b];
+            }
+            bsTranspose64<P>(rows);
+            for (int i = 0; i < 64; i++) {
+                P::unpack(rows[i], w);
+                for (int g = 0; g < P::GROUPS; g++) {
+                    unsigned char* p = output + (g * 64 + i) * 16 + half * 8;
+                    unsigned int lo = static_cast<unsigned int>(w[g]);
+                    unsigned int hi = static_cast<unsigned int>(w[g] >> 32);
+                    p[0] = (lo >> 24) & 0xFF; p[1] = (lo >> 16) & 0xFF; p[2] = (lo >> 8) & 0xFF; p[3] = lo & 0xFF;
+                    p[4] = (hi >> 24) & 0xFF; p[5] = (hi >> 16) & 0xFF; p[6] = (hi >> 8) & 0xFF; p[7] = hi & 0xFF;
+                }
+            }
+        }
+    }
+
+    // λƬPĿȳٰ64鴦β
+    template <typename P>
+    static SM4_INLINE void bitslicedBlocks(const unsigned char* input, unsigned char* output, size_t numBlocks, const unsigned int* rk) {
+        size_t i = 0;
+        for (; i + 64 * P::GROUPS <= numBlocks; i += 64 * P::GROUPS) {
+            cryptBitsliced<P>(input + i * 16, output + i * 16, rk);
+        }
+        for (; i + 64 <= numBlocks; i += 64) {
+            cryptBitsliced<BitPlane64>(input + i * 16, output + i * 16, rk);
+        }
+        if (i < numBlocks) {
+            unsigned char buf[64 * 16] = { 0 };
+            memcpy(buf, input + i * 16, (numBlocks - i) * 16);
+            cryptBitsliced<BitPlane64>(buf, buf, rk);
+            memcpy(output + i * 16, buf, (numBlocks - i) * 16);
+        }
+    }
+
+    static void bitsliced64(const unsigned char* input, unsigned char* output, size_t numBlocks, const unsigned int* rk) {
+        bitslicedBlocks<BitPlane64>(input, output, numBlocks, rk);
+    }
+
+    SM4_TARGET("avx2") SM4_FLATTEN
+    static void bitslicedAVX2(const unsigned char* input, unsigned char* output, size_t numBlocks, const unsigned int* rk) {
+        bitslicedBlocks<BitPlaneAVX2>(input, output, numBlocks, rk);
+    }
+
+    SM4_TARGET("avx512f") SM4_FLATTEN
+    static void bitslicedAVX512(const unsigned char* input, unsigned char* output, size_t numBlocks, const unsigned int* rk) {
+        bitslicedBlocks<BitPlaneAVX512>(input, output, numBlocks, rk);
+    }
+
+    // ָȵλƬںˣCPU֧ʱΪnullptr
+    static auto bitslicedFor(SM4BitsliceWidth width) -> decltype(&bitsliced64) {
+        const CpuFeatures& f = cpuFeatures();
+        switch (width) {
+        case SM4BitsliceWidth::W64:
+            return bitsliced64;
+        case SM4BitsliceWidth::AVX2:
+            return f.avx2 ? bitslicedAVX2 : nullptr;
+        case SM4BitsliceWidth::AVX512:
+            return f.avx512f ? bitslicedAVX512 : nullptr;
+        default:
+            return f.avx512f ? bitslicedAVX512 : f.avx2 ? bitslicedAVX2 : bitsliced64;
+        }
+    }
+
+    // ʵֵĺָλƬSʵֻ֣λƽѡ
+    static const Kernels* kernelTable(SM4Impl impl) {
+        static const auto bitsliced = bitslicedFor(SM4BitsliceWidth::Auto);
+        static const Kernels tables[] = {
+            { SM4Impl::Scalar, "", ecbScalar, ctrScalar, cbcDecryptScalar, cbcEncrypt8Scalar, xtsScalar, expandKeysScalar, multiKeyScalar, bitsliced },
+            { SM4Impl::AVX2, "AVX2 + Tgather", ecbAVX2, ctrAVX2, cbcDecryptAVX2, cbcEncrypt8AVX2, xtsAVX2, expandKeysAVX2, multiKeyAVX2, bitsliced },
+            { SM4Impl::AESNI, "AVX2 + AES-NI", ecbAESNI, ctrAESNI, cbcDecryptAESNI, cbcEncrypt8AESNI, xtsAESNI, expandKeysAESNI, multiKeyAESNI, bitsliced },
+            { SM4Impl::GFNI, "AVX2 + GFNI", ecbGFNI, ctrGFNI, cbcDecryptGFNI, cbcEncrypt8GFNI, xtsGFNI, expandKeysGFNI, multiKeyGFNI, bitsliced }
+        };
+        return &tables[static_cast<int>(impl)];
+    }
+
+    // ߳ʵʹõ߳ʱ1
+    unsigned bulkThreads(size_t bytes) const {
+        if (bytes < minThreadedBytes || bytes <= BULK_CHUNK) {
+            return 1;
+        }
+        unsigned n = threadCount;
+        if (n == 0) {
+            n = max(1u, thread::hardware_concurrency());
+        }
+        return n;
+    }
+
+    // ֶݲ8飨128ֽڣһprocessԭش
+    // ֱԭλôεһƴӵջϵ128ֽڻдظΣ
+    // һԲ128ֽ
+    template <typename F>
+    static void iovBatches(const SM4IoVec* iov, size_t count, const F& process) {
+        alignas(32) unsigned char batch[128];
+        struct Piece {
+            unsigned char* p;
+            size_t len;
+        } pieces[128];
+        size_t fill = 0, numPieces = 0;
+
+        auto flush = [&] {
+            process(batch, fill);
+            size_t pos = 0;
+            for (size_t k = 0; k < numPieces; k++) {
+                memcpy(pieces[k].p, batch + pos, pieces[k].len);
+                pos += pieces[k].len;
+            }
+            fill = 0;
+            numPieces = 0;
+        };
+        auto gather = [&](unsigned char* p, size_t len) {
+            if (len == 0) {
+                return;
+            }
+            memcpy(batch + fill, p, len);
+            pieces[numPieces++] = { p, len };
+            fill += len;
+            if (fill == sizeof(batch)) {
+                flush();
+            }
+        };
+
+        for (size_t i = 0; i < count; i++) {
+            // նβռƴӼ¼ÿٹ1ֽڣpieces128
+            if (iov[i].len == 0) {
+                continue;
+            }
+            unsigned char* p = iov[i].base;
+            size_t n = iov[i].len;
+            if (fill > 0) {
+                size_t take = min(n, sizeof(batch) - fill);
+                gather(p, take);
+                p += take;
+                n -= take;
+            }
+            size_t direct = n / sizeof(batch) * sizeof(batch);
+            if (direct > 0) {
+                process(p, direct);
+                p += direct;
+                n -= direct;
+            }
+            if (n > 0) {
+                gather(p, n);
+            }
+        }
+        if (fill > 0) {
+            flush();
+        }
+    }
+
+    static size_t iovTotal(const SM4IoVec* iov, size_t count) {
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += iov[i].len;
+        }
+        return total;
+    }
+
+    // CTR/ܵʵ֣ctr_xcrypt̡߳iovecӿڸãͳƣ
+    void ctrCrypt(const unsigned char iv[16], const unsigned char* input, unsigned char* output,
+        size_t len, unsigned long long offset) const {
+        unsigned int ctr[4];
+        for (int i = 0; i < 4; i++) {
+            ctr[i] = (iv[i * 4] << 24) | (iv[i * 4 + 1] << 16)
+                | (iv[i * 4 + 2] << 8) | iv[i * 4 + 3];
+        }
+        counterAdd(ctr, offset / 16);
+
+        // ϴεĲ
+        size_t skip = offset % 16;
+        if (skip != 0 && len > 0) {
+            unsigned char block[16], stream[16];
+            storeCounter(ctr, block);
+            encrypt(block, stream);
+            counterAdd(ctr, 1);
+
+            size_t n = min(len, 16 - skip);
+            for (size_t i = 0; i < n; i++) {
+                output[i] = input[i] ^ stream[skip + i];
+            }
+            input += n;
+            output += n;
+            len -= n;
+        }
+
+        if (len > 0) {
+            kernels->ctr(*this, ctr, input, output, len);
+        }
+    }
+
+    // CBCܵʵ֣鴮Уcbc_encryptiovec8·ӿڸ
+    void cbcEncryptBlocks(unsigned char iv[16], const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        unsigned char block[16];
+        for (size_t i = 0; i < numBlocks; i++) {
+            for (int j = 0; j < 16; j++) {
+                block[j] = input[i * 16 + j] ^ iv[j];
+            }
+            encrypt(block, iv);
+            memcpy(output + i * 16, iv, 16);
+        }
+    }
+
+    // ߳ECBBULK_CHUNKֿ飬ÿڹ߳ѡSIMDں
+    void ecbBulk(const unsigned char* input, unsigned char* output, size_t numBlocks, const unsigned int* rk) const {
+        SM4_TRACE(ECB, kernels->impl, numBlocks * 16);
+        unsigned threads = bulkThreads(numBlocks * 16);
+        if (threads <= 1) {
+            kernels->ecb(*this, input, output, numBlocks, rk);
+            return;
+        }
+        const size_t chunkBlocks = BULK_CHUNK / 16;
+        size_t chunks = (numBlocks + chunkBlocks - 1) / chunkBlocks;
+        SM4ThreadPool::instance().run(chunks, threads, [&](size_t c) {
+            size_t first = c * chunkBlocks;
+            kernels->ecb(*this, input + first * 16, output + first * 16, min(chunkBlocks, numBlocks - first), rk);
+        });
+    }
+public:
+    // 캯ֻԿչڴҲ
+    SM4(const unsigned char key[16])
+        : kernels(kernelTable(sm4BestImpl())), threadCount(0), minThreadedBytes(1 << 20) {
+        SM4_TRACE(KeySetup, kernels->impl, 16);
+        keySchedule(key);
+    }
+
+    // ԿչõԿ죬ʡȥԿչ
+    SM4(const SM4KeySchedule& schedule)
+        : kernels(kernelTable(sm4BestImpl())), threadCount(0), minThreadedBytes(1 << 20) {
+        setRoundKeys(schedule.rk);
+    }
+
+    // ԿչkeysΪcount16ֽԿschedules[i]ΪiԿļԿ
+    // ֧AVX2ʱÿSIMDͨͬʱչ16/8Կimpl֧ʱ˻رʵ
+    static void expandKeys(const unsigned char* keys, SM4KeySchedule* schedules, size_t count,
+        SM4Impl impl = sm4BestImpl()) {
+        const Kernels* k = kernelTable(sm4ImplSupported(impl) ? impl : SM4Impl::Scalar);
+        SM4_TRACE(KeySetup, k->impl, count * 16);
+        k->expandKeys(keys, schedules, count);
+    }
+
+    // ԿECBܣischedules[i]ܣ¼Կ֧ԭش
+    static void encryptMultiKey(const SM4KeySchedule* schedules, const unsigned char* input,
+        unsigned char* output, size_t numBlocks, SM4Impl impl = sm4BestImpl()) {
+        const Kernels* k = kernelTable(sm4ImplSupported(impl) ? impl : SM4Impl::Scalar);
+        SM4_TRACE(MultiKey, k->impl, numBlocks * 16);
+        k->multiKey(schedules, input, output, numBlocks, false);
+    }
+
+    // ԿECB
+    static void decryptMultiKey(const SM4KeySchedule* schedules, const unsigned char* input,
+        unsigned char* output, size_t numBlocks, SM4Impl impl = sm4BestImpl()) {
+        const Kernels* k = kernelTable(sm4ImplSupported(impl) ? impl : SM4Impl::Scalar);
+        SM4_TRACE(MultiKey, k->impl, numBlocks * 16);
+        k->multiKey(schedules, input, output, numBlocks, true);
+    }
+
+    // ָ·ʵ֣CPU֧ʱfalseԭã
+    bool setImpl(SM4Impl impl) {
+        if (!sm4ImplSupported(impl)) {
+            return false;
+        }
+        kernels = kernelTable(impl);
+        return true;
+    }
+
+    // ָλƬλƽȣCPU֧ʱfalseԭãAutoָCPUѡ
+    bool setBitsliceWidth(SM4BitsliceWidth width) {
+        auto kernel = bitslicedFor(width);
+        if (kernel == nullptr) {
+            return false;
+        }
+        bitslicedKernel = width == SM4BitsliceWidth::Auto ? nullptr : kernel;
+        return true;
+    }
+
+    // ǰʹõʵ
+    SM4Impl impl() const {
+        return kernels->impl;
+    }
+
+    const char* implName() const {
+        return kernels->name;
+    }
+
+    // 16ֽݿ
+    void encrypt(const unsigned char input[16], unsigned char output[16]) const {
+        cryptBlock(input, output, roundKeys.data());
+    }
+
+    // 16ֽݿ飨ʹԤɵԿɶ̹߳ͬһ
+    void decrypt(const unsigned char input[16], unsigned char output[16]) const {
+        cryptBlock(input, output, decRoundKeys.data());
+    }
+
+    // ö߳ӿڣencryptBulk/decryptBulk/ctr_xcrypt_bulk߳0Ϊȫ߼ˣ
+    // СminBytesʱֱڵ߳д
+    void setThreads(unsigned threads, size_t minBytes = 1 << 20) {
+        threadCount = threads;
+        minThreadedBytes = minBytes;
+    }
+
+    // мܣECBѡʵ֧
+    void encryptParallel(const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        SM4_TRACE(ECB, kernels->impl, numBlocks * 16);
+        kernels->ecb(*this, input, output, numBlocks, roundKeys.data());
+    }
+
+    // нܣECBѡʵ֧
+    void decryptParallel(const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        SM4_TRACE(ECB, kernels->impl, numBlocks * 16);
+        kernels->ecb(*this, input, output, numBlocks, decRoundKeys.data());
+    }
+
+    // CTRģʽ/ܣͬ
+    // ivΪ128λ˳ʼoffsetΪԿеֽƫƣ
+    // ֶεʱѴֽ֧ⳤ
+    void ctr_xcrypt(const unsigned char iv[16], const unsigned char* input, unsigned char* output,
+        size_t len, unsigned long long offset = 0) const {
+        SM4_TRACE(CTR, kernels->impl, len);
+        ctrCrypt(iv, input, output, len, offset);
+    }
+
+    // ߳ECBܣֿ̳߳زдencryptParallelͬ
+    void encryptBulk(const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        ecbBulk(input, output, numBlocks, roundKeys.data());
+    }
+
+    // ߳ECB
+    void decryptBulk(const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        ecbBulk(input, output, numBlocks, decRoundKeys.data());
+    }
+
+    // ߳CTR/ܣctr_xcryptͬ鰴Կеƫƶ
+    void ctr_xcrypt_bulk(const unsigned char iv[16], const unsigned char* input, unsigned char* output,
+        size_t len, unsigned long long offset = 0) const {
+        SM4_TRACE(CTR, kernels->impl, len);
+        unsigned threads = bulkThreads(len);
+        if (threads <= 1) {
+            ctrCrypt(iv, input, output, len, offset);
+            return;
+        }
+        size_t chunks = (len + BULK_CHUNK - 1) / BULK_CHUNK;
+        SM4ThreadPool::instance().run(chunks, threads, [&](size_t c) {
+            size_t first = c * BULK_CHUNK;
+            ctrCrypt(iv, input + first, output + first, min(BULK_CHUNK, len - first), offset + first);
+        });
+    }
+
+    // CBCģʽܣ·䴮
+    // úivΪһķ飬ɼܺ
+    void cbc_encrypt(unsigned char iv[16], const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        SM4_TRACE(CBC, kernels->impl, numBlocks * 16);
+        cbcEncryptBlocks(iv, input, output, numBlocks);
+    }
+
+    // 8·CBC֯ܣk·ʹiv[k]input[k]output[k]ΪnumBlocks[k]
+    // ֧AVX2ʱÿ·ռһSIMDִͨ֯У·ȿԲͬ
+    // úiv[k]Ϊ·һķ
+    void cbc_encrypt8(unsigned char iv[8][16], const unsigned char* const input[8],
+        unsigned char* const output[8], const size_t numBlocks[8]) const {
+        SM4_TRACE(CBC, kernels->impl, (numBlocks[0] + numBlocks[1] + numBlocks[2] + numBlocks[3]
+            + numBlocks[4] + numBlocks[5] + numBlocks[6] + numBlocks[7]) * 16);
+        kernels->cbcEncrypt8(*this, iv, input, output, numBlocks);
+    }
+
+    // CBCģʽܣɶܣѡʵ
+    // ֧ԭؽܣinput == outputúivΪһķ
+    void cbc_decrypt(unsigned char iv[16], const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        SM4_TRACE(CBC, kernels->impl, numBlocks * 16);
+        kernels->cbcDecrypt(*this, iv, input, output, numBlocks);
+    }
+
+    // ==================== ɢ/ۼiovecӿ ====================
+    // ݷֲڶĶУԭؼ/ܣЧͬڸβӺĵ
+    // εķ128ֽڵƴӻд8SIMDںˣҪ帴
+
+    // ECBԭؼܣܳΪ16ıfalse
+    bool encrypt_iov(const SM4IoVec* iov, size_t count) const {
+        size_t total = iovTotal(iov, count);
+        if (total % 16 != 0) {
+            return false;
+        }
+        SM4_TRACE(ECB, kernels->impl, total);
+        iovBatches(iov, count, [this](unsigned char* p, size_t len) {
+            kernels->ecb(*this, p, p, len / 16, roundKeys.data());
+        });
+        return true;
+    }
+
+    // ECBԭؽ
+    bool decrypt_iov(const SM4IoVec* iov, size_t count) const {
+        size_t total = iovTotal(iov, count);
+        if (total % 16 != 0) {
+            return false;
+        }
+        SM4_TRACE(ECB, kernels->impl, total);
+        iovBatches(iov, count, [this](unsigned char* p, size_t len) {
+            kernels->ecb(*this, p, p, len / 16, decRoundKeys.data());
+        });
+        return true;
+    }
+
+    // CTRԭؼ/ܣⳤȣivoffsetĺͬctr_xcrypt
+    void ctr_xcrypt_iov(const unsigned char iv[16], const SM4IoVec* iov, size_t count,
+        unsigned long long offset = 0) const {
+        SM4_TRACE(CTR, kernels->impl, iovTotal(iov, count));
+        iovBatches(iov, count, [&](unsigned char* p, size_t len) {
+            ctrCrypt(iv, p, p, len, offset);
+            offset += len;
+        });
+    }
+
+    // CBCԭؼܣܳΪ16ıúivΪһķ
+    bool cbc_encrypt_iov(unsigned char iv[16], const SM4IoVec* iov, size_t count) const {
+        size_t total = iovTotal(iov, count);
+        if (total % 16 != 0) {
+            return false;
+        }
+        SM4_TRACE(CBC, kernels->impl, total);
+        iovBatches(iov, count, [&](unsigned char* p, size_t len) {
+            cbcEncryptBlocks(iv, p, p, len / 16);
+        });
+        return true;
+    }
+
+    // CBCԭؽܣܳΪ16ıúivΪһķ
+    bool cbc_decrypt_iov(unsigned char iv[16], const SM4IoVec* iov, size_t count) const {
+        size_t total = iovTotal(iov, count);
+        if (total % 16 != 0) {
+            return false;
+        }
+        SM4_TRACE(CBC, kernels->impl, total);
+        iovBatches(iov, count, [&](unsigned char* p, size_t len) {
+            kernels->cbcDecrypt(*this, iv, p, p, len / 16);
+        });
+        return true;
+    }
+
+    // λƬܣʱ䣬޲ÿ64/256/512飬ӿencryptParallelͬ
+    void encryptBitsliced(const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        SM4_TRACE(Bitsliced, kernels->impl, numBlocks * 16);
+        (bitslicedKernel != nullptr ? bitslicedKernel : kernels->bitsliced)(input, output, numBlocks, roundKeys.data());
+    }
+
+    // λƬ
+    void decryptBitsliced(const unsigned char* input, unsigned char* output, size_t numBlocks) const {
+        SM4_TRACE(Bitsliced, kernels->impl, numBlocks * 16);
+        (bitslicedKernel != nullptr ? bitslicedKernel : kernels->bitsliced)(input, output, numBlocks, decRoundKeys.data());
+    }
+};
+
+constexpr SM4::TTable SM4::T_TABLE = SM4::buildTTable();
+
+// ==================== SM4-GCMGB/T 36624 / RFC 8998 ====================
+// ֤ܣCTRģʽ + GHASH֤֧PCLMULQDQʱCTRԿGHASH
+// ͬһɣÿ8ԿõĲдٶ
+// ֱڼĴH^8..H^18·ۺϳ˷8ֻһģԼ
+class SM4GCM {
+public:
+    // ʱH = E_K(0^128)1..8
+    SM4GCM(const unsigned char key[16]) : sm4(key) {
+        unsigned char zero[16] = { 0 }, h[16];
+        sm4.encrypt(zero, h);
+        hScalar[0] = load64(h);
+        hScalar[1] = load64(h + 8);
+        if (cpuFeatures().pclmul) {
+            initPowers(h, hPow);
+        }
+    }
+
+    // ָײSM4ʵ֣ScalarʱGHASHҲ߱ʵ֣
+    bool setImpl(SM4Impl impl) {
+        return sm4.setImpl(impl);
+    }
+
+    const SM4& cipher() const {
+        return sm4;
+    }
+
+    // ܣivΪⳤȵĳʼƼ12ֽڣaadΪ֤ݣ
+    // lenֽ16ֽ֤ǩ֧ԭؼ
+    void encrypt(const unsigned char* iv, size_t ivLen, const unsigned char* aad, size_t aadLen,
+        const unsigned char* input, unsigned char* output, size_t len, unsigned char tag[16]) const {
+        crypt(iv, ivLen, aad, aadLen, input, output, len, false, tag);
+    }
+
+    // ܲУǩʱȽϣУʧʱfalse
+    bool decrypt(const unsigned char* iv, size_t ivLen, const unsigned char* aad, size_t aadLen,
+        const unsigned char* input, unsigned char* output, size_t len, const unsigned char tag[16]) const {
+        unsigned char expected[16];
+        crypt(iv, ivLen, aad, aadLen, input, output, len, true, expected);
+        unsigned char diff = 0;
+        for (int i = 0; i < 16; i++) {
+            diff |= expected[i] ^ tag[i];
+        }
+        if (diff != 0) {
+            memset(output, 0, len);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    SM4 sm4;
+    // H1..8ݣPCLMULʾֽڷ
+    alignas(16) unsigned char hPow[8][16];
+    // HĴ˱ʾGHASHã
+    uint64_t hScalar[2];
+
+    static inline uint64_t load64(const unsigned char* p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++) {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+
+    static inline void store64(unsigned char* p, uint64_t v) {
+        for (int i = 7; i >= 0; i--) {
+            p[i] = static_cast<unsigned char>(v);
+            v >>= 8;
+        }
+    }
+
+    // ---------- PCLMULQDQʵֵGHASH ----------
+
+    // 16ֽ巴ʹGCMı˳PCLMULĶʽʾӦ
+    SM4_TARGET("pclmul,ssse3")
+    static inline __m128i reflect(__m128i v) {
+        return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+    }
+
+    // 128x128λ޽λ˷ۼӵδԼ256λlo, mid, hi
+    SM4_TARGET("pclmul,ssse3")
+    static inline void clmulAcc(__m128i a, __m128i b, __m128i& lo, __m128i& mid, __m128i& hi) {
+        lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, b, 0x00));
+        hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, b, 0x11));
+        mid = _mm_xor_si128(mid, _mm_xor_si128(
+            _mm_clmulepi64_si128(a, b, 0x01), _mm_clmulepi64_si128(a, b, 0x10)));
+    }
+
+    // 256λ1λʾģx^128+x^7+x^2+x+1Լ
+    SM4_TARGET("pclmul,ssse3")
+    static inline __m128i reduce(__m128i lo, __m128i mid, __m128i hi) {
+        lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+        hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+        __m128i t7 = _mm_srli_epi32(lo, 31);
+        __m128i t8 = _mm_srli_epi32(hi, 31);
+        lo = _mm_slli_epi32(lo, 1);
+        hi = _mm_slli_epi32(hi, 1);
+        __m128i t9 = _mm_srli_si128(t7, 12);
+        t8 = _mm_slli_si128(t8, 4);
+        t7 = _mm_slli_si128(t7, 4);
+        lo = _mm_or_si128(lo, t7);
+        hi = _mm_or_si128(_mm_or_si128(hi, t8), t9);
+
+        t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+        t8 = _mm_srli_si128(t7, 4);
+        lo = _mm_xor_si128(lo, _mm_slli_si128(t7, 12));
+        __m128i t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+        lo = _mm_xor_si128(lo, _mm_xor_si128(t2, t8));
+        return _mm_xor_si128(hi, lo);
+    }
+
+    SM4_TARGET("pclmul,ssse3")
+    static inline __m128i gfmul(__m128i a, __m128i b) {
+        __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        clmulAcc(a, b, lo, mid, hi);
+        return reduce(lo, mid, hi);
+    }
+
+    SM4_TARGET("pclmul,ssse3")
+    static void initPowers(const unsigned char h[16], unsigned char pow[8][16]) {
+        __m128i h1 = reflect(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h)));
+        __m128i p = h1;
+        for (int i = 0; i < 8; i++) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(pow[i]), p);
+            p = gfmul(p, h1);
+        }
+    }
+
+    // 8ۺϣacc = (acc ^ b0)H^8 ^ b1H^7 ^ ... ^ b7HֻԼһ
+    SM4_TARGET("pclmul,ssse3")
+    static inline __m128i ghash8(__m128i acc, const __m128i b[8], const __m128i h[8]) {
+        __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        clmulAcc(_mm_xor_si128(acc, reflect(b[0])), h[7], lo, mid, hi);
+        for (int i = 1; i < 8; i++) {
+            clmulAcc(reflect(b[i]), h[7 - i], lo, mid, hi);
+        }
+        return reduce(lo, mid, hi);
+    }
+
+    // ⳤGHASHĩβ16ֽʱ㣩xΪGCMֽۼֵ
+    SM4_TARGET("pclmul,ssse3")
+    static void ghashPCLMUL(const SM4GCM& g, unsigned char x[16], const unsigned char* data, size_t len) {
+        __m128i h[8];
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(g.hPow[i]));
+        }
+        __m128i acc = reflect(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+        for (; len >= 128; data += 128, len -= 128) {
+            __m128i b[8];
+            for (int i = 0; i < 8; i++) {
+                b[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16));
+            }
+            acc = ghash8(acc, b, h);
+        }
+        for (; len >= 16; data += 16, len -= 16) {
+            acc = gfmul(_mm_xor_si128(acc, reflect(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)))), h[0]);
+        }
+        if (len > 0) {
+            alignas(16) unsigned char last[16] = { 0 };
+            memcpy(last, data, len);
+            acc = gfmul(_mm_xor_si128(acc, reflect(_mm_load_si128(reinterpret_cast<const __m128i*>(last)))), h[0]);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(x), reflect(acc));
+    }
+
+    // ---------- GHASH֧PCLMULQDQʱʹã ----------
+
+    // λ˷NIST SP 800-38D㷨1X = XH
+    static void gfmulScalar(uint64_t x[2], const uint64_t h[2]) {
+        uint64_t z0 = 0, z1 = 0, v0 = h[0], v1 = h[1];
+        for (int i = 0; i < 128; i++) {
+            uint64_t bit = (i < 64 ? x[0] >> (63 - i) : x[1] >> (127 - i)) & 1;
+            uint64_t mask = 0 - bit;
+            z0 ^= v0 & mask;
+            z1 ^= v1 & mask;
+            uint64_t carry = 0 - (v1 & 1);
+            v1 = (v1 >> 1) | (v0 << 63);
+            v0 = (v0 >> 1) ^ (0xE100000000000000ull & carry);
+        }
+        x[0] = z0;
+        x[1] = z1;
+    }
+
+    static void ghashScalar(const SM4GCM& g, unsigned char x[16], const unsigned char* data, size_t len) {
+        uint64_t acc[2] = { load64(x), load64(x + 8) };
+        while (len > 0) {
+            unsigned char block[16] = { 0 };
+            size_t n = min(len, static_cast<size_t>(16));
+            memcpy(block, data, n);
+            acc[0] ^= load64(block);
+            acc[1] ^= load64(block + 8);
+            gfmulScalar(acc, g.hScalar);
+            data += n;
+            len -= n;
+        }
+        store64(x, acc[0]);
+        store64(x + 8, acc[1]);
+    }
+
+    // ---------- CTR + GHASH ----------
+
+    // ·CTR32λٶGHASH
+    static void cryptScalar(const SM4GCM& g, const unsigned char counter[16], const unsigned char* input,
+        unsigned char* output, size_t len, bool decrypting, unsigned char x[16]) {
+        if (decrypting) {
+            ghashScalar(g, x, input, len);
+        }
+        unsigned char block[16], stream[16];
+        memcpy(block, counter, 16);
+        unsigned int c = (block[12] << 24) | (block[13] << 16) | (block[14] << 8) | block[15];
+        for (size_t pos = 0; pos < len; pos += 16) {
+            g.sm4.encrypt(block, stream);
+            c++;
+            block[12] = c >> 24; block[13] = (c >> 16) & 0xFF; block[14] = (c >> 8) & 0xFF; block[15] = c & 0xFF;
+            size_t n = min(len - pos, static_cast<size_t>(16));
+            for (size_t i = 0; i < n; i++) {
+                output[pos + i] = input[pos + i] ^ stream[i];
+            }
+        }
+        if (!decrypting) {
+            ghashScalar(g, x, output, len);
+        }
+    }
+
+    // ں·ÿ8һԿڼĴֱӽ8·ۺGHASH
+    template <typename SLayer>
+    SM4_TARGET("avx2,pclmul")
+    static void cryptFused(const SM4GCM& g, const unsigned char counter[16], const unsigned char* input,
+        unsigned char* output, size_t len, bool decrypting, unsigned char x[16]) {
+        const SM4& c = g.sm4;
+        const SLayer t(c);
+        const unsigned int* rk = c.roundKeys.data();
+        unsigned int ctr[4];
+        for (int i = 0; i < 4; i++) {
+            ctr[i] = (counter[i * 4] << 24) | (counter[i * 4 + 1] << 16)
+                | (counter[i * 4 + 2] << 8) | counter[i * 4 + 3];
+        }
+        // 32λģ2^32λλͨ˳Ϊ0,2,4,6,1,3,5,7
+        const __m256i laneOffset = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        const __m256i x0 = _mm256_set1_epi32(ctr[0]);
+        const __m256i x1 = _mm256_set1_epi32(ctr[1]);
+        const __m256i x2 = _mm256_set1_epi32(ctr[2]);
+        unsigned int low = ctr[3];
+
+        __m128i h[8];
+        for (int i = 0; i < 8; i++) {
+            h[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(g.hPow[i]));
+        }
+        __m128i acc = reflect(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+
+        while (len > 0) {
+            __m256i s0 = x0, s1 = x1, s2 = x2;
+            __m256i s3 = _mm256_add_epi32(_mm256_set1_epi32(low), laneOffset);
+            low += 8;
+            SM4::roundLoop8(s0, s1, s2, s3, rk, t);
+            __m256i k[4];
+            SM4::unload8(s0, s1, s2, s3, k[0], k[1], k[2], k[3]);
+
+            __m128i blocks[8];
+            if (len >= 128) {
+                for (int i = 0; i < 4; i++) {
+                    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input) + i);
+                    __m256i o = _mm256_xor_si256(d, k[i]);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output) + i, o);
+                    __m256i cipher = decrypting ? d : o;
+                    blocks[i * 2] = _mm256_castsi256_si128(cipher);
+                    blocks[i * 2 + 1] = _mm256_extracti128_si256(cipher, 1);
+                }
+                acc = ghash8(acc, blocks, h);
+                input += 128;
+                output += 128;
+                len -= 128;
+            }
+            else {
+                // βȸ루ԭشĲGHASH
+                alignas(32) unsigned char stream[128], cipher[128] = { 0 };
+                for (int i = 0; i < 4; i++) {
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(stream) + i, k[i]);
+                }
+                if (decrypting) {
+                    memcpy(cipher, input, len);
+                }
+                for (size_t i = 0; i < len; i++) {
+                    output[i] = input[i] ^ stream[i];
+                }
+                if (!decrypting) {
+                    memcpy(cipher, output, len);
+                }
+                for (size_t i = 0; i < len; i += 16) {
+                    acc = gfmul(_mm_xor_si128(acc, reflect(
+                        _mm_load_si128(reinterpret_cast<const __m128i*>(cipher + i)))), h[0]);
+                }
+                len = 0;
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(x), reflect(acc));
+    }
+
+    typedef void (*CryptFn)(const SM4GCM& g, const unsigned char counter[16], const unsigned char* input,
+        unsigned char* output, size_t len, bool decrypting, unsigned char x[16]);
+
+    SM4_TARGET("avx2,pclmul") SM4_FLATTEN
+    static void cryptFusedAVX2(const SM4GCM& g, const unsigned char counter[16], const unsigned char* input,
+        unsigned char* output, size_t len, bool decrypting, unsigned char x[16]) {
+        cryptFused<SM4::TableSLayer>(g, counter, input, output, len, decrypting, x);
+    }
+
+    SM4_TARGET("avx2,aes,pclmul") SM4_FLATTEN
+    static void cryptFusedAESNI(const SM4GCM& g, const unsigned char counter[16], const unsigned char* input,
+        unsigned char* output, size_t len, bool decrypting, unsigned char x[16]) {
+        cryptFused<SM4::AesniSLayer>(g, counter, input, output, len, decrypting, x);
+    }
+
+    SM4_TARGET("avx2,gfni,pclmul") SM4_FLATTEN
+    static void cryptFusedGFNI(const SM4GCM& g, const unsigned char counter[16], const unsigned char* input,
+        unsigned char* output, size_t len, bool decrypting, unsigned char x[16]) {
+        cryptFused<SM4::GfniSLayer>(g, counter, input, output, len, decrypting, x);
+    }
+
+    void crypt(const unsigned char* iv, size_t ivLen, const unsigned char* aad, size_t aadLen,
+        const unsigned char* input, unsigned char* output, size_t len, bool decrypting, unsigned char tag[16]) const {
+        SM4_TRACE(GCM, sm4.impl(), len);
+        // ײSM4ʵѡں·ʵֻ֧PCLMULQDQʱ߱·
+        CryptFn cryptData = cryptScalar;
+        void (*ghash)(const SM4GCM&, unsigned char*, const unsigned char*, size_t) = ghashScalar;
+        if (cpuFeatures().pclmul) {
+            switch (sm4.impl()) {
+            case SM4Impl::AVX2: cryptData = cryptFusedAVX2; break;
+            case SM4Impl::AESNI: cryptData = cryptFusedAESNI; break;
+            case SM4Impl::GFNI: cryptData = cryptFusedGFNI; break;
+            default: break;
+            }
+            if (cryptData != cryptScalar) {
+                ghash = ghashPCLMUL;
+            }
+        }
+
+        // ʼJ012ֽIVֱƴӼ1IVGHASH
+        unsigned char j0[16] = { 0 };
+        if (ivLen == 12) {
+            memcpy(j0, iv, 12);
+            j0[15] = 1;
+        }
+        else {
+            unsigned char lenBlock[16] = { 0 };
+            ghash(*this, j0, iv, ivLen);
+            store64(lenBlock + 8, static_cast<uint64_t>(ivLen) * 8);
+            ghash(*this, j0, lenBlock, 16);
+        }
+
+        // 
+        unsigned char x[16] = { 0 };
+        ghash(*this, x, aad, aadLen);
+
+        // ݴinc32(J0)ʼ
+        unsigned char counter[16];
+        memcpy(counter, j0, 16);
+        for (int i = 15; i >= 12; i--) {
+            if (++counter[i] != 0) {
+                break;
+            }
+        }
+        if (len > 0) {
+            cryptData(*this, counter, input, output, len, decrypting, x);
+        }
+
+        // ȷ飬ǩ = E_K(J0) ^ GHASH
+        unsigned char lenBlock[16];
+        store64(lenBlock, static_cast<uint64_t>(aadLen) * 8);
+        store64(lenBlock + 8, static_cast<uint64_t>(len) * 8);
+        ghash(*this, x, lenBlock, 16);
+
+        unsigned char mask[16];
+        sm4.encrypt(j0, mask);
+        for (int i = 0; i < 16; i++) {
+            tag[i] = x[i] ^ mask[i];
+        }
+    }
+};
+
+
+// ==================== SM4-XTSIEEE Std 1619 ====================
+// ݵԪĿɵ룺K2ŵõʼֵT
+// jĵֵΪT^jֵSIMDλɣ8/16·ת·
+// Ȳ16ıʱŲôķ
+class SM4XTS {
+public:
+    // һnumberΪţݵԪţlenС16ֽ
+    struct Sector {
+        unsigned long long number;
+        const unsigned char* input;
+        unsigned char* output;
+        size_t len;
+    };
+
+    // dataKeyڼݣtweakKeyڼţӦͬ
+    SM4XTS(const unsigned char dataKey[16], const unsigned char tweakKey[16])
+        : dataCipher(dataKey), tweakCipher(tweakKey) {
+    }
+
+    // ָײSM4ʵ֣CPU֧ʱfalseԭã
+    bool setImpl(SM4Impl impl) {
+        return dataCipher.setImpl(impl) && tweakCipher.setImpl(impl);
+    }
+
+    const SM4& cipher() const {
+        return dataCipher;
+    }
+
+    // ӿڵ߳ͬSM4::setThreads
+    void setThreads(unsigned threads, size_t minBytes = 1 << 20) {
+        dataCipher.setThreads(threads, minBytes);
+    }
+
+    // һlen < 16ʱfalse֧ԭؼ
+    bool encrypt(unsigned long long sector, const unsigned char* input, unsigned char* output, size_t len) const {
+        return cryptSector(sector, input, output, len, false);
+    }
+
+    // һ
+    bool decrypt(unsigned long long sector, const unsigned char* input, unsigned char* output, size_t len) const {
+        return cryptSector(sector, input, output, len, true);
+    }
+
+    // 128λֵ루OpenSSLȽӿеIVһݵԪ
+    // ŽӿڵȼivΪŵ128λС˱
+    bool encryptWithIV(const unsigned char iv[16], const unsigned char* input, unsigned char* output, size_t len) const {
+        return cryptIV(iv, input, output, len, false);
+    }
+
+    bool decryptWithIV(const unsigned char iv[16], const unsigned char* input, unsigned char* output, size_t len) const {
+        return cryptIV(iv, input, output, len, true);
+    }
+
+    // һһI/O󣩣ųSIMDܵõֵ
+    // ϴʱ̳߳вдС16ʱfalse
+    bool encryptSectors(const Sector* sectors, size_t count) const {
+        return cryptSectors(sectors, count, false);
+    }
+
+    // һ
+    bool decryptSectors(const Sector* sectors, size_t count) const {
+        return cryptSectors(sectors, count, true);
+    }
+
+private:
+    SM4 dataCipher;
+    SM4 tweakCipher;
+
+    // ÿһһECBںˣҲ̳߳ص
+    static constexpr size_t SECTOR_GROUP = 64;
+
+    // Ű128λС˱
+    static void encodeSector(unsigned long long sector, unsigned char block[16]) {
+        for (int i = 0; i < 8; i++) {
+            block[i] = static_cast<unsigned char>(sector >> (8 * i));
+        }
+        memset(block + 8, 0, 8);
+    }
+
+    // 飺out = E(in ^ T) ^ T
+    static void cryptBlockXTS(const unsigned char tweak[16], const unsigned char* input,
+        unsigned char* output, const unsigned int* rk) {
+        unsigned char block[16];
+        for (int j = 0; j < 16; j++) {
+            block[j] = input[j] ^ tweak[j];
+        }
+        SM4::cryptBlock(block, block, rk);
+        for (int j = 0; j < 16; j++) {
+            output[j] = block[j] ^ tweak[j];
+        }
+    }
+
+    // ѼܵĵֵһݵԪ
+    void cryptUnit(const unsigned char encTweak[16], const unsigned char* input, unsigned char* output,
+        size_t len, bool decrypting) const {
+        const unsigned int* rk = decrypting ? dataCipher.decRoundKeys.data() : dataCipher.roundKeys.data();
+        size_t full = len / 16, partial = len % 16;
+        // вʱһŲ
+        size_t bulk = partial ? full - 1 : full;
+
+        unsigned char tweak[16];
+        memcpy(tweak, encTweak, 16);
+        if (bulk > 0) {
+            dataCipher.kernels->xts(dataCipher, tweak, input, output, bulk, rk);
+        }
+        if (partial == 0) {
+            return;
+        }
+
+        // ŲãֱʹT^(m-1)T^mʱ˳෴
+        unsigned char nextTweak[16];
+        memcpy(nextTweak, tweak, 16);
+        SM4::xtsMulAlpha(nextTweak);
+
+        const unsigned char* in = input + bulk * 16;
+        unsigned char* out = output + bulk * 16;
+        unsigned char last[16], merged[16];
+        cryptBlockXTS(decrypting ? nextTweak : tweak, in, last, rk);
+        // ȶд֧ԭش
+        memcpy(merged, in + 16, partial);
+        memcpy(merged + partial, last + partial, 16 - partial);
+        memcpy(out + 16, last, partial);
+        cryptBlockXTS(decrypting ? tweak : nextTweak, merged, out, rk);
+    }
+
+    bool cryptSector(unsigned long long sector, const unsigned char* input, unsigned char* output,
+        size_t len, bool decrypting) const {
+        if (len < 16) {
+            return false;
+        }
+        unsigned char iv[16];
+        encodeSector(sector, iv);
+        return cryptIV(iv, input, output, len, decrypting);
+    }
+
+    bool cryptIV(const unsigned char iv[16], const unsigned char* input, unsigned char* output,
+        size_t len, bool decrypting) const {
+        if (len < 16) {
+            return false;
+        }
+        SM4_TRACE(XTS, dataCipher.impl(), len);
+        unsigned char tweak[16];
+        tweakCipher.encrypt(iv, tweak);
+        cryptUnit(tweak, input, output, len, decrypting);
+        return true;
+    }
+
+    // group
+    void cryptGroup(const Sector* sectors, size_t count, size_t group, bool decrypting) const {
+        size_t first = group * SECTOR_GROUP;
+        size_t n = min(SECTOR_GROUP, count - first);
+        // ںֻдǰnΪGCCmaybe-uninitialized
+        unsigned char tweaks[SECTOR_GROUP * 16] = { 0 };
+        for (size_t k = 0; k < n; k++) {
+            encodeSector(sectors[first + k].number, tweaks + k * 16);
+        }
+        // ֱӵںˣֵļܲͳ
+        tweakCipher.kernels->ecb(tweakCipher, tweaks, tweaks, n, tweakCipher.roundKeys.data());
+        for (size_t k = 0; k < n; k++) {
+            const Sector& s = sectors[first + k];
+            if (s.len >= 16) {
+                cryptUnit(tweaks + k * 16, s.input, s.output, s.len, decrypting);
+            }
+        }
+    }
+
+    bool cryptSectors(const Sector* sectors, size_t count, bool decrypting) const {
+        size_t total = 0;
+        bool ok = true;
+        for (size_t k = 0; k < count; k++) {
+            total += sectors[k].len;
+            ok = ok && sectors[k].len >= 16;
+        }
+        SM4_TRACE(XTS, dataCipher.impl(), total);
+
+        size_t groups = (count + SECTOR_GROUP - 1) / SECTOR_GROUP;
+        unsigned threads = dataCipher.bulkThreads(total);
+        if (threads <= 1 || groups <= 1) {
+            for (size_t g = 0; g < groups; g++) {
+                cryptGroup(sectors, count, g, decrypting);
+            }
+        }
+        else {
+            SM4ThreadPool::instance().run(groups, threads, [&](size_t g) {
+                cryptGroup(sectors, count, g, decrypting);
+            });
+        }
+        return ok;
+    }
+};
+
+// ==================== ʽļ/ܵ ====================
+// ͨļmmapӳ룬ںֱӴӳȡдҳ漴ͷţ
+// ܵȲӳɶ߳仺߳ԭؼܡдɶ߳ɣ
+// ̡ܡдصڴռù̶ΪBUFFERSCHUNKļС޹
+
+enum class SM4StreamMode {
+    CTR,        // CTR/ܣⳤ
+    ECBEncrypt, // ECBܣΪ16ı
+    ECBDecrypt  // ECBܣΪ16ı
+};
+
+class SM4Stream {
+public:
+    // ÿĴС뻺ػ壺ܡдռһ
+    static constexpr size_t CHUNK = 4 << 20;
+    static constexpr int BUFFERS = 3;
+
+    // ivCTRģʽʹãΪ128λ˳ʼ̼߳ciphersetThreads
+    SM4Stream(const SM4& cipher, SM4StreamMode mode, const unsigned char iv[16] = nullptr)
+        : cipher(cipher), mode(mode), processed(0) {
+        if (iv != nullptr) {
+            memcpy(this->iv, iv, 16);
+        }
+        else {
+            memset(this->iv, 0, 16);
+        }
+    }
+
+    // inFdдoutFdдECBģʽ³Ȳ16ıʱfalse
+    bool crypt(int inFd, int outFd) {
+        storage.assign(BUFFERS * CHUNK + PAGE, 0);
+        uintptr_t p = reinterpret_cast<uintptr_t>(storage.data());
+        base = reinterpret_cast<unsigned char*>((p + PAGE - 1) & ~static_cast<uintptr_t>(PAGE - 1));
+        processed = 0;
+        ioFailed = false;
+        for (int i = 0; i < BUFFERS; i++) {
+            freeSlots.push({ i, 0 });
+        }
+
+        thread writer(&SM4Stream::writerMain, this, outFd);
+        bool ok;
+#ifndef _WIN32
+        struct stat st;
+        if (fstat(inFd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            ok = cryptMapped(inFd, static_cast<size_t>(st.st_size));
+        }
+        else
+#endif
+        {
+            ok = cryptBuffered(inFd);
+        }
+        writeSlots.push({ -1, 0 });
+        writer.join();
+
+        freeSlots.clear();
+        storage.clear();
+        storage.shrink_to_fit();
+        return ok && !ioFailed;
+    }
+
+    // ·"-"ʾ׼/׼ECBģʽͨļĳм顣
+    // дͬһĿ¼µʱļɹ̺ŸĿ꣺ʧʱĿ걣ԭ
+    // ΪͬһļԭؼܣʱҲڶȡǰضϡ
+    // Ѵڵķͨļ豸ֱܵд
+    bool crypt(const char* inPath, const char* outPath) {
+        int inFd = openFile(inPath, false);
+        if (inFd < 0) {
+            return false;
+        }
+#ifndef _WIN32
+        struct stat st;
+        if (mode != SM4StreamMode::CTR && fstat(inFd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size % 16 != 0) {
+            closeFile(inFd);
+            return false;
+        }
+        bool direct = strcmp(outPath, "-") == 0 || (stat(outPath, &st) == 0 && !S_ISREG(st.st_mode));
+#else
+        bool direct = strcmp(outPath, "-") == 0;
+#endif
+        if (direct) {
+            int outFd = openFile(outPath, true);
+            bool ok = outFd >= 0 && crypt(inFd, outFd);
+            closeFile(inFd);
+            closeFile(outFd);
+            return ok;
+        }
+
+        string tmpPath;
+        int outFd = openTemp(outPath, tmpPath);
+        if (outFd < 0) {
+            closeFile(inFd);
+            return false;
+        }
+        bool ok = crypt(inFd, outFd) && syncFile(outFd);
+        closeFile(inFd);
+        closeFile(outFd);
+        if (ok) {
+            ok = replaceFile(tmpPath.c_str(), outPath);
+        }
+        if (!ok) {
+            remove(tmpPath.c_str());
+        }
+        return ok;
+    }
+
+    // ϴcryptдֽ
+    unsigned long long processedBytes() const {
+        return processed;
+    }
+
+private:
+    static constexpr size_t PAGE = 4096;
+
+    // Чȣ-1ʾݽ
+    struct Slot {
+        int index;
+        size_t len;
+    };
+
+    // УлѶܡѼܴдһ
+    class SlotQueue {
+    public:
+        void push(Slot s) {
+            {
+                lock_guard<mutex> lock(m);
+                q.push_back(s);
+            }
+            cv.notify_one();
+        }
+        Slot pop() {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [this] { return !q.empty(); });
+            Slot s = q.front();
+            q.pop_front();
+            return s;
+        }
+        void clear() {
+            lock_guard<mutex> lock(m);
+            q.clear();
+        }
+    private:
+        mutex m;
+        condition_variable cv;
+        deque<Slot> q;
+    };
+
+    const SM4& cipher;
+    SM4StreamMode mode;
+    unsigned char iv[16];
+    vector<unsigned char> storage;
+    unsigned char* base = nullptr;
+    SlotQueue freeSlots, readSlots, writeSlots;
+    atomic<bool> ioFailed{ false };
+    unsigned long long processed;
+
+    unsigned char* buffer(const Slot& s) const {
+        return base + static_cast<size_t>(s.index) * CHUNK;
+    }
+
+    // һݣoffsetΪеֽƫƣCTRݴ˼
+    void cryptChunk(const unsigned char* input, unsigned char* output, size_t len, unsigned long long offset) const {
+        switch (mode) {
+        case SM4StreamMode::CTR:
+            cipher.ctr_xcrypt_bulk(iv, input, output, len, offset);
+            break;
+        case SM4StreamMode::ECBEncrypt:
+            cipher.encryptBulk(input, output, len / 16);
+            break;
+        case SM4StreamMode::ECBDecrypt:
+            cipher.decryptBulk(input, output, len / 16);
+            break;
+        }
+    }
+
+    bool lengthValid(size_t len) const {
+        return mode == SM4StreamMode::CTR || len % 16 == 0;
+    }
+
+#ifndef _WIN32
+    // ӳļCHUNKƽԤһ飬ܺͷŵǰҳ
+    bool cryptMapped(int fd, size_t size) {
+        if (!lengthValid(size)) {
+            return false;
+        }
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            return cryptBuffered(fd);
+        }
+        const unsigned char* src = static_cast<const unsigned char*>(map);
+        madvise(map, size, MADV_SEQUENTIAL);
+
+        for (size_t offset = 0; offset < size && !ioFailed; offset += CHUNK) {
+            size_t len = min(CHUNK, size - offset);
+            Slot s = freeSlots.pop();
+            if (offset + len < size) {
+                madvise(const_cast<unsigned char*>(src + offset + len), min(CHUNK, size - offset - len), MADV_WILLNEED);
+            }
+            cryptChunk(src + offset, buffer(s), len, offset);
+            madvise(const_cast<unsigned char*>(src + offset), len, MADV_DONTNEED);
+            writeSlots.push({ s.index, len });
+        }
+        munmap(map, size);
+        return true;
+    }
+#endif
+
+    // ߳һ󽻸̣߳߳ԭؼܺ󽻸д߳
+    bool cryptBuffered(int fd) {
+        atomic<bool> readFailed{ false };
+        thread reader([&] {
+            for (;;) {
+                Slot s = freeSlots.pop();
+                size_t n = readFull(fd, buffer(s), CHUNK, readFailed);
+                if (n > 0) {
+                    readSlots.push({ s.index, n });
+                }
+                else {
+                    freeSlots.push(s);
+                }
+                if (n < CHUNK || ioFailed) {
+                    readSlots.push({ -1, 0 });
+                    return;
+                }
+            }
+        });
+
+        bool ok = true;
+        unsigned long long offset = 0;
+        for (;;) {
+            Slot s = readSlots.pop();
+            if (s.index < 0) {
+                break;
+            }
+            // ֻһܲ16ı
+            if (!lengthValid(s.len)) {
+                ok = false;
+                freeSlots.push(s);
+                continue;
+            }
+            cryptChunk(buffer(s), buffer(s), s.len, offset);
+            offset += s.len;
+            writeSlots.push(s);
+        }
+        reader.join();
+        return ok && !readFailed;
+    }
+
+    void writerMain(int fd) {
+        for (;;) {
+            Slot s = writeSlots.pop();
+            if (s.index < 0) {
+                return;
+            }
+            if (!ioFailed) {
+                if (writeFull(fd, buffer(s), s.len)) {
+                    processed += s.len;
+                }
+                else {
+                    ioFailed = true;
+                }
+            }
+            freeSlots.push(s);
+        }
+    }
+
+    // lenֽڻļĩβΪֹ
+    static size_t readFull(int fd, unsigned char* p, size_t len, atomic<bool>& failed) {
+        size_t done = 0;
+        while (done < len) {
+#ifdef _WIN32
+            int n = _read(fd, p + done, static_cast<unsigned>(min(len - done, static_cast<size_t>(1 << 30))));
+#else
+            ssize_t n = ::read(fd, p + done, len - done);
+#endif
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                failed = true;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return done;
+    }
+
+    static bool writeFull(int fd, const unsigned char* p, size_t len) {
+        while (len > 0) {
+#ifdef _WIN32
+            int n = _write(fd, p, static_cast<unsigned>(min(len, static_cast<size_t>(1 << 30))));
+#else
+            ssize_t n = ::write(fd, p, len);
+#endif
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static int openFile(const char* path, bool forWrite) {
+        if (strcmp(path, "-") == 0) {
+#ifdef _WIN32
+            _setmode(forWrite ? 1 : 0, _O_BINARY);
+#endif
+            return forWrite ? 1 : 0;
+        }
+#ifdef _WIN32
+        return forWrite ? _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)
+            : _open(path, _O_RDONLY | _O_BINARY);
+#else
+        return forWrite ? ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : ::open(path, O_RDONLY);
+#endif
+    }
+
+    // ĿĿ¼ʱļļĿѴʱȨޣΪ0644
+    static int openTemp(const char* outPath, string& tmpPath) {
+#ifdef _WIN32
+        tmpPath = string(outPath) + ".tmp";
+        return _open(tmpPath.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        tmpPath = string(outPath) + ".XXXXXX";
+        int fd = mkstemp(&tmpPath[0]);
+        if (fd < 0) {
+            return -1;
+        }
+        struct stat st;
+        mode_t perm = stat(outPath, &st) == 0 ? (st.st_mode & 07777) : 0644;
+        if (fchmod(fd, perm) != 0) {
+            ::close(fd);
+            remove(tmpPath.c_str());
+            return -1;
+        }
+        return fd;
+#endif
+    }
+
+    static bool syncFile(int fd) {
+#ifdef _WIN32
+        return _commit(fd) == 0;
+#else
+        return fsync(fd) == 0;
+#endif
+    }
+
+    // src滻dstCRTrenameWindows²Ѵڵļfilesystem::rename
+    static bool replaceFile(const char* src, const char* dst) {
+#ifdef _WIN32
+        error_code ec;
+        filesystem::rename(src, dst, ec);
+        return !ec;
+#else
+        return rename(src, dst) == 0;
+#endif
+    }
+
+    static void closeFile(int fd) {
+        if (fd > 2) {
+#ifdef _WIN32
+            _close(fd);
+#else
+            ::close(fd);
+#endif
+        }
+    }
+};
+
+// 32λʮַΪ16ֽ
+static bool parseHex16(const char* s, unsigned char out[16]) {
+    if (strlen(s) != 32) {
+        return false;
+    }
+    for (int i = 0; i < 32; i++) {
+        char c = s[i];
+        int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+            : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+        if (v < 0) {
+            return false;
+        }
+        out[i / 2] = static_cast<unsigned char>((i % 2 == 0) ? v << 4 : out[i / 2] | v);
+    }
+    return true;
+}
+
+// ==================== ܲԣbench ====================
+// ÿģʽʵݳȣԤȣʱԤڷãTSC¼ÿεõ
+// λ99λӳ١ÿֽJSON׼
+// ύ֮Ƚϣȱ׼
+
+struct BenchResult {
+    size_t calls;
+    double cyclesPerByte;   // λӳټ
+    double gbps;            // ȫõƽ
+    double p50Ns;
+    double p99Ns;
+};
+
+// TSCƵʣÿļ
+static double tscPerNs() {
+    auto t0 = chrono::steady_clock::now();
+    unsigned long long c0 = __rdtsc();
+    while (chrono::steady_clock::now() - t0 < chrono::milliseconds(50)) {
+    }
+    unsigned long long c1 = __rdtsc();
+    chrono::duration<double, nano> ns = chrono::steady_clock::now() - t0;
+    return static_cast<double>(c1 - c0) / ns.count();
+}
+
+// ԤԼʮ֮һԤʱ5εã100000
+template <typename F>
+static BenchResult benchmarkCall(size_t bytes, double budgetMs, double tscNs, const F& call) {
+    auto warmEnd = chrono::steady_clock::now() + chrono::duration<double, milli>(budgetMs / 10);
+    do {
+        call();
+    } while (chrono::steady_clock::now() < warmEnd);
+
+    vector<unsigned long long> samples;
+    unsigned long long total = 0;
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double, milli>(budgetMs);
+    do {
+        unsigned long long c0 = __rdtsc();
+        call();
+        unsigned long long c1 = __rdtsc();
+        samples.push_back(c1 - c0);
+        total += c1 - c0;
+    } while ((samples.size() < 5 || chrono::steady_clock::now() < deadline) && samples.size() < 100000);
+
+    sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    BenchResult r;
+    r.calls = n;
+    r.cyclesPerByte = static_cast<double>(samples[n / 2]) / bytes;
+    r.gbps = static_cast<double>(bytes) * n / (static_cast<double>(total) / tscNs);
+    r.p50Ns = samples[n / 2] / tscNs;
+    r.p99Ns = samples[min(n - 1, n * 99 / 100)] / tscNs;
+    return r;
+}
+
+// K/M/G׺ֽ
+static size_t parseSize(const char* s) {
+    char* end = nullptr;
+    double v = strtod(s, &end);
+    switch (end != nullptr ? *end : '\0') {
+    case 'K': case 'k': v *= 1024; break;
+    case 'M': case 'm': v *= 1024 * 1024; break;
+    case 'G': case 'g': v *= 1024.0 * 1024 * 1024; break;
+    default: break;
+    }
+    return static_cast<size_t>(v);
+}
+
+// bench [--min-size N] [--max-size N] [--time-ms T] [--mode ] [--impl ]
+// ȴmin-sizeÿγ4Ĭ16B..16MBɵ1G
+static int runBenchmark(int argc, char* argv[]) {
+    size_t minSize = 16, maxSize = 16 << 20;
+    double budgetMs = 20;
+    const char* onlyMode = nullptr;
+    const char* onlyImpl = nullptr;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--min-size") == 0) {
+            minSize = max(static_cast<size_t>(16), parseSize(argv[i + 1]) / 16 * 16);
+        }
+        else if (strcmp(argv[i], "--max-size") == 0) {
+            maxSize = parseSize(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--time-ms") == 0) {
+            budgetMs = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--mode") == 0) {
+            onlyMode = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--impl") == 0) {
+            onlyImpl = argv[i + 1];
+        }
+        else {
+            cerr << "δ֪: " << argv[i] << endl;
+            return 2;
+        }
+    }
+
+    const unsigned char key[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10
+    };
+    const unsigned char iv[16] = { 0 };
+    unsigned char tag[16];
+    vector<unsigned char> data(maxSize, 0x5A);
+    vector<SM4XTS::Sector> sectors;
+
+    struct ImplInfo {
+        SM4Impl impl;
+        const char* name;
+    };
+    const ImplInfo impls[] = {
+        { SM4Impl::Scalar, "scalar" }, { SM4Impl::AVX2, "avx2" }, { SM4Impl::AESNI, "aesni" }, { SM4Impl::GFNI, "gfni" }
+    };
+    const char* modes[] = { "ecb", "ecb-bulk", "ctr", "cbc-enc", "cbc-dec", "xts", "gcm", "bitsliced" };
+
+    double tscNs = tscPerNs();
+    cout << "{\n  \"benchmark\": \"sm4\",\n  \"tsc_ghz\": " << fixed << setprecision(3) << tscNs
+        << ",\n  \"threads\": " << thread::hardware_concurrency() << ",\n  \"results\": [";
+    cerr << fixed << left << setw(10) << "mode" << setw(8) << "impl" << right << setw(12) << "bytes"
+        << setw(10) << "cpb" << setw(10) << "GB/s" << setw(14) << "p50(ns)" << setw(14) << "p99(ns)" << endl;
+
+    bool first = true;
+    for (const ImplInfo& im : impls) {
+        if (!sm4ImplSupported(im.impl) || (onlyImpl != nullptr && strcmp(onlyImpl, im.name) != 0)) {
+            continue;
+        }
+        SM4 sm4(key);
+        SM4XTS xts(key, iv);
+        SM4GCM gcm(key);
+        sm4.setImpl(im.impl);
+        xts.setImpl(im.impl);
+        gcm.setImpl(im.impl);
+
+        for (const char* mode : modes) {
+            if (onlyMode != nullptr && strcmp(onlyMode, mode) != 0) {
+                continue;
+            }
+            for (size_t size = minSize; size <= maxSize; size *= 4) {
+                unsigned char* p = data.data();
+                size_t blocks = size / 16;
+                unsigned char chain[16];
+                memcpy(chain, iv, 16);
+
+                // XTS4KB4KBʱΪһݵԪһ
+                size_t sectorSize = min(size, static_cast<size_t>(4096));
+                sectors.clear();
+                for (size_t pos = 0; pos < size && strcmp(mode, "xts") == 0; pos += sectorSize) {
+                    sectors.push_back({ pos / sectorSize, p + pos, p + pos, sectorSize });
+                }
+
+                BenchResult r;
+                if (strcmp(mode, "ecb") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { sm4.encryptParallel(p, p, blocks); });
+                }
+                else if (strcmp(mode, "ecb-bulk") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { sm4.encryptBulk(p, p, blocks); });
+                }
+                else if (strcmp(mode, "ctr") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { sm4.ctr_xcrypt(iv, p, p, size); });
+                }
+                else if (strcmp(mode, "cbc-enc") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { sm4.cbc_encrypt(chain, p, p, blocks); });
+                }
+                else if (strcmp(mode, "cbc-dec") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { sm4.cbc_decrypt(chain, p, p, blocks); });
+                }
+                else if (strcmp(mode, "xts") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { xts.encryptSectors(sectors.data(), sectors.size()); });
+                }
+                else if (strcmp(mode, "gcm") == 0) {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { gcm.encrypt(iv, 12, nullptr, 0, p, p, size, tag); });
+                }
+                else {
+                    r = benchmarkCall(size, budgetMs, tscNs, [&] { sm4.encryptBitsliced(p, p, blocks); });
+                }
+
+                cout << (first ? "\n" : ",\n") << "    {\"mode\": \"" << mode << "\", \"impl\": \"" << im.name
+                    << "\", \"bytes\": " << size << ", \"calls\": " << r.calls
+                    << setprecision(3) << ", \"cycles_per_byte\": " << r.cyclesPerByte
+                    << ", \"gb_per_s\": " << r.gbps << ", \"p50_ns\": " << setprecision(1) << r.p50Ns
+                    << ", \"p99_ns\": " << r.p99Ns << "}";
+                first = false;
+                cerr << left << setw(10) << mode << setw(8) << im.name << right << setw(12) << size
+                    << setprecision(2) << setw(10) << r.cyclesPerByte << setprecision(3) << setw(10) << r.gbps
+                    << setprecision(1) << setw(14) << r.p50Ns << setw(14) << r.p99Ns << endl;
+                if (size > maxSize / 4) {
+                    break;
+                }
+            }
+        }
+    }
+    cout << "\n  ]\n}" << endl;
+    return 0;
+}
+
+// ==================== Լ죨selftest ====================
+// ׼GB/T 32907¼A1000000εRFC 8998GCMֲԣ
+// ʵֵSIMD//߳·Կ£õ
+// ĲοֽڱȽ
+
+// 128λ˼n
+static void counterAddBytes(unsigned char ctr[16], unsigned long long n) {
+    for (int i = 15; i >= 0 && n != 0; i--) {
+        unsigned long long v = ctr[i] + (n & 0xFF);
+        ctr[i] = static_cast<unsigned char>(v);
+        n = (n >> 8) + (v >> 8);
+    }
+}
+
+// selftest [] []
+static int runSelfTest(int argc, char* argv[]) {
+    unsigned rounds = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 200;
+    unsigned long long seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 2025;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what, const char* impl, size_t len) {
+        if (!ok) {
+            failures++;
+            cerr << "ʧ: " << what << " [" << impl << "]  " << len << endl;
+        }
+    };
+
+    // ---------- ׼ ----------
+    unsigned char key[16], block[16];
+    parseHex16("0123456789abcdeffedcba9876543210", key);
+    unsigned char expected1[16], expectedMillion[16];
+    parseHex16("681edf34d206965e86b3e94f536e4246", expected1);
+    parseHex16("595298c7c6fd271f0402f804c33d3f66", expectedMillion);
+
+    SM4 reference(key);
+    reference.setImpl(SM4Impl::Scalar);
+    reference.encrypt(key, block);
+    check(memcmp(block, expected1, 16) == 0, "GB/T 32907 1 ", "single", 16);
+    reference.decrypt(block, block);
+    check(memcmp(block, key, 16) == 0, "GB/T 32907 1 ", "single", 16);
+    memcpy(block, key, 16);
+    for (int i = 0; i < 1000000; i++) {
+        reference.encrypt(block, block);
+    }
+    check(memcmp(block, expectedMillion, 16) == 0, "GB/T 32907 2 1000000ε", "single", 16);
+
+    // RFC 8998 ¼A.1
+    unsigned char gcmIv[12], gcmTag[16], expectedTag[16];
+    memcpy(gcmIv, "\x00\x00\x12\x34\x56\x78\x00\x00\x00\x00\xAB\xCD", 12);
+    const unsigned char gcmAad[20] = {
+        0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+        0xAB, 0xAD, 0xDA, 0xD2
+    };
+    parseHex16("83de3541e4c2b58177e065a9bf7b62ec", expectedTag);
+    const unsigned char gcmPattern[8] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF, 0xEE, 0xAA };
+    unsigned char gcmPlain[64], gcmCipher[64];
+    for (int i = 0; i < 64; i++) {
+        gcmPlain[i] = gcmPattern[i / 8];
+    }
+
+    struct ImplInfo {
+        SM4Impl impl;
+        const char* name;
+    };
+    const ImplInfo impls[] = {
+        { SM4Impl::Scalar, "scalar" }, { SM4Impl::AVX2, "avx2" }, { SM4Impl::AESNI, "aesni" }, { SM4Impl::GFNI, "gfni" }
+    };
+    for (const ImplInfo& im : impls) {
+        SM4GCM gcm(key);
+        if (!gcm.setImpl(im.impl)) {
+            continue;
+        }
+        gcm.encrypt(gcmIv, 12, gcmAad, 20, gcmPlain, gcmCipher, 64, gcmTag);
+        check(memcmp(gcmTag, expectedTag, 16) == 0, "RFC 8998 GCMǩ", im.name, 64);
+    }
+
+    // SM4-XTSIEEE 1619ֵOpenSSLԼevpciph_sm4.txtе
+    // 56ֽ = 3 + 8ֽڣŲ
+    const unsigned char xtsPlain[56] = {
+        0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+        0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+        0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+        0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17
+    };
+    const unsigned char xtsCipher[56] = {
+        0xE9, 0x53, 0x82, 0x51, 0xC7, 0x1D, 0x7B, 0x80, 0xBB, 0xE4, 0x48, 0x3F, 0xEF, 0x49, 0x7B, 0xD1,
+        0xB3, 0xDB, 0x1A, 0x3E, 0x60, 0x40, 0x8C, 0x57, 0x5D, 0x63, 0xFF, 0x7D, 0xB3, 0x9F, 0x83, 0x26,
+        0x08, 0x69, 0xF9, 0xE2, 0x58, 0x5F, 0xEC, 0x9F, 0x0B, 0x86, 0x3B, 0xF8, 0xFD, 0x78, 0x4B, 0x86,
+        0x27, 0xD1, 0x6C, 0x0D, 0xB6, 0xD2, 0xCF, 0xC7
+    };
+    unsigned char xtsKey1[16], xtsKey2[16], xtsIv[16], xtsOut[56];
+    parseHex16("2b7e151628aed2a6abf7158809cf4f3c", xtsKey1);
+    parseHex16("000102030405060708090a0b0c0d0e0f", xtsKey2);
+    parseHex16("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", xtsIv);
+    for (const ImplInfo& im : impls) {
+        SM4XTS xts(xtsKey1, xtsKey2);
+        if (!xts.setImpl(im.impl)) {
+            continue;
+        }
+        xts.encryptWithIV(xtsIv, xtsPlain, xtsOut, sizeof(xtsOut));
+        check(memcmp(xtsOut, xtsCipher, sizeof(xtsOut)) == 0, "SM4-XTS", im.name, sizeof(xtsOut));
+        xts.decryptWithIV(xtsIv, xtsCipher, xtsOut, sizeof(xtsOut));
+        check(memcmp(xtsOut, xtsPlain, sizeof(xtsOut)) == 0, "SM4-XTS", im.name, sizeof(xtsOut));
+    }
+
+    // ---------- ֲ ----------
+    mt19937_64 rng(seed);
+    const size_t MAX_BLOCKS = 3000;
+    vector<unsigned char> src(MAX_BLOCKS * 16 + 64), dst(MAX_BLOCKS * 16 + 64), expect(MAX_BLOCKS * 16 + 64),
+        back(MAX_BLOCKS * 16 + 64);
+    size_t checks = 0;
+
+    for (const ImplInfo& im : impls) {
+        if (!sm4ImplSupported(im.impl)) {
+            continue;
+        }
+        for (unsigned r = 0; r < rounds; r++) {
+            unsigned char k1[16], k2[16], iv[16];
+            for (int i = 0; i < 16; i++) {
+                k1[i] = static_cast<unsigned char>(rng());
+                k2[i] = static_cast<unsigned char>(rng());
+                iv[i] = static_cast<unsigned char>(rng());
+            }
+            // ԶΪ8/16εı߽磬żȡ
+            size_t blocks = (r % 8 == 0) ? rng() % MAX_BLOCKS : rng() % 40;
+            size_t bytes = blocks * 16;
+            unsigned char* in = src.data() + rng() % 32;
+            unsigned char* out = dst.data() + rng() % 32;
+            for (size_t i = 0; i < bytes + 16; i++) {
+                in[i] = static_cast<unsigned char>(rng());
+            }
+
+            SM4 ref(k1);
+            ref.setImpl(SM4Impl::Scalar);
+            SM4 c(k1);
+            c.setImpl(im.impl);
+            // ߳·СҲ
+            c.setThreads(3, 0);
+
+            // ECB
+            for (size_t i = 0; i < blocks; i++) {
+                ref.encrypt(in + i * 16, expect.data() + i * 16);
+            }
+            c.encryptParallel(in, out, blocks);
+            check(memcmp(out, expect.data(), bytes) == 0, "ECB", im.name, bytes);
+            c.decryptParallel(out, back.data(), blocks);
+            check(memcmp(back.data(), in, bytes) == 0, "ECB", im.name, bytes);
+            c.encryptBulk(in, out, blocks);
+            check(memcmp(out, expect.data(), bytes) == 0, "ECB̼߳", im.name, bytes);
+            c.encryptBitsliced(in, out, blocks);
+            check(memcmp(out, expect.data(), bytes) == 0, "λƬ", im.name, bytes);
+            c.decryptBitsliced(expect.data(), out, blocks);
+            check(memcmp(out, in, bytes) == 0, "λƬ", im.name, bytes);
+
+            // CTRⳤʼƫ
+            size_t ctrLen = bytes + rng() % 16;
+            unsigned long long offset = rng() % 100000;
+            unsigned char counter[16], stream[16];
+            memcpy(counter, iv, 16);
+            counterAddBytes(counter, offset / 16);
+            for (size_t i = 0; i < ctrLen; i++) {
+                size_t pos = static_cast<size_t>(offset % 16) + i;
+                if (i == 0 || pos % 16 == 0) {
+                    ref.encrypt(counter, stream);
+                    counterAddBytes(counter, 1);
+                }
+                expect[i] = in[i] ^ stream[pos % 16];
+            }
+            c.ctr_xcrypt(iv, in, out, ctrLen, offset);
+            check(memcmp(out, expect.data(), ctrLen) == 0, "CTR", im.name, ctrLen);
+            c.ctr_xcrypt_bulk(iv, in, out, ctrLen, offset);
+            check(memcmp(out, expect.data(), ctrLen) == 0, "CTR߳", im.name, ctrLen);
+
+            // CTRɢ/ۼжΣԭشʱһնΣһƴӼ¼
+            memcpy(out, in, ctrLen);
+            vector<SM4IoVec> segments;
+            for (size_t pos = 0; pos < ctrLen;) {
+                size_t len = min(ctrLen - pos, static_cast<size_t>(rng() % 200));
+                segments.push_back({ out + pos, len });
+                pos += len;
+                if (rng() % 4 == 0) {
+                    segments.insert(segments.end(), rng() % 300, SM4IoVec{ out + pos, 0 });
+                }
+            }
+            c.ctr_xcrypt_iov(iv, segments.data(), segments.size(), offset);
+            check(memcmp(out, expect.data(), ctrLen) == 0, "CTRɢ/ۼ", im.name, ctrLen);
+
+            // CBCɢ/ۼ֮300ն
+            if (blocks > 0) {
+                memcpy(out, in, 16);
+                segments.assign(1, SM4IoVec{ out, 8 });
+                segments.insert(segments.end(), 300, SM4IoVec{ out + 8, 0 });
+                segments.push_back({ out + 8, 8 });
+                unsigned char ivIov[16];
+                memcpy(ivIov, iv, 16);
+                ref.cbc_encrypt(ivIov, in, expect.data(), 1);
+                memcpy(ivIov, iv, 16);
+                check(c.cbc_encrypt_iov(ivIov, segments.data(), segments.size())
+                    && memcmp(out, expect.data(), 16) == 0, "CBCɢ/ۼնΣ", im.name, 16);
+            }
+
+            // CBC
+            unsigned char chain[16], chainRef[16];
+            memcpy(chainRef, iv, 16);
+            ref.cbc_encrypt(chainRef, in, expect.data(), blocks);
+            memcpy(chain, iv, 16);
+            c.cbc_decrypt(chain, expect.data(), out, blocks);
+            check(memcmp(out, in, bytes) == 0 && (blocks == 0 || memcmp(chain, chainRef, 16) == 0),
+                "CBC", im.name, bytes);
+
+            // 8·CBC·Ȳͬͬһ
+            unsigned char ivs[8][16], ivsRef[8][16];
+            const unsigned char* ins[8];
+            unsigned char* outs[8];
+            size_t lens[8];
+            vector<unsigned char> out8(8 * bytes + 16), expect8(8 * bytes + 16);
+            for (int k = 0; k < 8; k++) {
+                memcpy(ivs[k], iv, 16);
+                ivs[k][0] ^= static_cast<unsigned char>(k);
+                memcpy(ivsRef[k], ivs[k], 16);
+                lens[k] = rng() % (blocks + 1);
+                ins[k] = in;
+                outs[k] = out8.data() + k * bytes;
+                ref.cbc_encrypt(ivsRef[k], in, expect8.data() + k * bytes, lens[k]);
+            }
+            c.cbc_encrypt8(ivs, ins, outs, lens);
+            check(memcmp(out8.data(), expect8.data(), 8 * bytes) == 0 && memcmp(ivs, ivsRef, sizeof(ivs)) == 0,
+                "8·CBC", im.name, bytes);
+
+            // ԿչԿECBiԿȡinĵi
+            vector<SM4KeySchedule> schedules(blocks), schedulesRef(blocks);
+            SM4::expandKeys(in, schedules.data(), blocks, im.impl);
+            SM4::expandKeys(in, schedulesRef.data(), blocks, SM4Impl::Scalar);
+            check(blocks == 0 || memcmp(schedules.data(), schedulesRef.data(), blocks * sizeof(SM4KeySchedule)) == 0,
+                "Կչ", im.name, bytes);
+            for (size_t i = 0; i < blocks; i++) {
+                SM4(in + i * 16).encrypt(in + i * 16, expect.data() + i * 16);
+            }
+            SM4::encryptMultiKey(schedules.data(), in, out, blocks, im.impl);
+            check(memcmp(out, expect.data(), bytes) == 0, "Կ", im.name, bytes);
+
+            // XTSʵֱȽϣ
+            size_t xtsLen = max(static_cast<size_t>(16), bytes + rng() % 16);
+            unsigned long long sector = rng();
+            SM4XTS xts(k1, k2), xtsRef(k1, k2);
+            xts.setImpl(im.impl);
+            xtsRef.setImpl(SM4Impl::Scalar);
+            xtsRef.encrypt(sector, in, expect.data(), xtsLen);
+            xts.encrypt(sector, in, out, xtsLen);
+            check(memcmp(out, expect.data(), xtsLen) == 0, "XTS", im.name, xtsLen);
+            xts.decrypt(sector, out, back.data(), xtsLen);
+            check(memcmp(back.data(), in, xtsLen) == 0, "XTS", im.name, xtsLen);
+
+            // GCMʵֱȽϣȵIV븽
+            size_t gcmLen = bytes + rng() % 16;
+            size_t ivLen = (r % 4 == 0) ? 1 + rng() % 40 : 12;
+            size_t aadLen = rng() % 70;
+            SM4GCM gcm(k1), gcmRef(k1);
+            gcm.setImpl(im.impl);
+            gcmRef.setImpl(SM4Impl::Scalar);
+            unsigned char tag[16], tagRef[16];
+            gcmRef.encrypt(in, ivLen, in + 7, aadLen, in, expect.data(), gcmLen, tagRef);
+            gcm.encrypt(in, ivLen, in + 7, aadLen, in, out, gcmLen, tag);
+            check(memcmp(out, expect.data(), gcmLen) == 0 && memcmp(tag, tagRef, 16) == 0, "GCM", im.name, gcmLen);
+            check(gcm.decrypt(in, ivLen, in + 7, aadLen, out, back.data(), gcmLen, tag)
+                && memcmp(back.data(), in, gcmLen) == 0, "GCM", im.name, gcmLen);
+            checks++;
+        }
+    }
+
+    // λƬĬֻCPUλƽ棬խĿֻβǿʹã
+    // һAVX-512512飩ʹÿֿȶ
+    struct WidthInfo {
+        SM4BitsliceWidth width;
+        const char* name;
+    };
+    const WidthInfo widths[] = {
+        { SM4BitsliceWidth::W64, "bs64" }, { SM4BitsliceWidth::AVX2, "bs-avx2" }, { SM4BitsliceWidth::AVX512, "bs-avx512" }
+    };
+    for (unsigned r = 0; r < rounds / 20 + 1; r++) {
+        unsigned char k[16];
+        for (int i = 0; i < 16; i++) {
+            k[i] = static_cast<unsigned char>(rng());
+        }
+        size_t blocks = 512 + rng() % (MAX_BLOCKS - 512);
+        size_t bytes = blocks * 16;
+        for (size_t i = 0; i < bytes; i++) {
+            src[i] = static_cast<unsigned char>(rng());
+        }
+        SM4 ref(k);
+        ref.setImpl(SM4Impl::Scalar);
+        ref.encryptParallel(src.data(), expect.data(), blocks);
+        for (const WidthInfo& w : widths) {
+            SM4 c(k);
+            if (!c.setBitsliceWidth(w.width)) {
+                continue;
+            }
+            c.encryptBitsliced(src.data(), dst.data(), blocks);
+            check(memcmp(dst.data(), expect.data(), bytes) == 0, "λƬ", w.name, bytes);
+            c.decryptBitsliced(expect.data(), dst.data(), blocks);
+            check(memcmp(dst.data(), src.data(), bytes) == 0, "λƬ", w.name, bytes);
+        }
+        checks++;
+    }
+
+    cout << "׼ֲ: " << checks << "  " << seed << ""
+        << (failures == 0 ? "ȫͨ" : "ʧ") << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// 
+static int runCommand(int argc, char* argv[]) {
+    if (strcmp(argv[1], "selftest") == 0) {
+        return runSelfTest(argc, argv);
+    }
+    if (strcmp(argv[1], "bench") == 0) {
+        return runBenchmark(argc, argv);
+    }
+    if (argc == 7 && strcmp(argv[1], "stream") == 0) {
+        SM4StreamMode mode;
+        if (strcmp(argv[2], "ctr") == 0) {
+            mode = SM4StreamMode::CTR;
+        }
+        else if (strcmp(argv[2], "ecb-enc") == 0) {
+            mode = SM4StreamMode::ECBEncrypt;
+        }
+        else if (strcmp(argv[2], "ecb-dec") == 0) {
+            mode = SM4StreamMode::ECBDecrypt;
+        }
+        else {
+            cerr << "δ֪ģʽ: " << argv[2] << endl;
+            return 2;
+        }
+        unsigned char key[16], iv[16];
+        if (!parseHex16(argv[3], key) || !parseHex16(argv[4], iv)) {
+            cerr << "ԿIVΪ32λʮַ" << endl;
+            return 2;
+        }
+
+        SM4 sm4(key);
+        SM4Stream stream(sm4, mode, iv);
+        auto start = chrono::high_resolution_clock::now();
+        bool ok = stream.crypt(argv[5], argv[6]);
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+        if (!ok) {
+            cerr << "ʧܣдECBģʽݳȲ16ı" << endl;
+            return 1;
+        }
+        cerr << "Ѵ " << stream.processedBytes() << " ֽڣʱ " << fixed << setprecision(3)
+            << elapsed.count() << " " << endl;
+        return 0;
+    }
+
+    cerr << "÷:" << endl;
+    cerr << "  " << argv[0] << "                 ʾܲ" << endl;
+    cerr << "  " << argv[0] << " stream <ctr|ecb-enc|ecb-dec> <Կhex> <IVhex> <|-> <|->" << endl;
+    cerr << "  " << argv[0] << " selftest [] []" << endl;
+    cerr << "  " << argv[0] << " bench [--min-size 16] [--max-size 16M] [--time-ms 20] [--mode ctr] [--impl gfni]" << endl;
+    return 2;
+}
+
+// 
+int main(int argc, char* argv[]) {
+    // ʱִʽӽܡԼ졢ܲԣʾ
+    if (argc > 1) {
+        int status = runCommand(argc, argv);
+#ifdef SM4_INSTRUMENT
+        cerr << SM4Metrics::exportText();
+#endif
+        return status;
+    }
+
+    unsigned char key[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF
+    };
+
+    unsigned char plaintext[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF
+    };
+
+    unsigned char ciphertext[16];
+    unsigned char decrypted[16];
+
+    SM4 sm4(key);
+
+    cout << "ԭʼ: ";
+    for (int i = 0; i < 16; i++) {
         cout << hex << setw(2) << setfill('0')
             << (int)plaintext[i] << " ";
     }
@@ -406,6 +3970,7 @@ int main() {
 
 
     cout << "============== ܲ ==============" << endl;
+    cout << "·ʵ: " << sm4.implName() << endl;
     const size_t TEST_SIZE = 16 * 1024 * 1024;
     const size_t BLOCK_COUNT = TEST_SIZE / 16;
     unsigned char* bigData = new unsigned char[TEST_SIZE];
@@ -439,6 +4004,14 @@ int main() {
     cout << ": " << fixed << setprecision(2)
         << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl << endl;
 
+    if (memcmp(bigData, decryptedData, TEST_SIZE) == 0) {
+        cout << "֤: ȫƥ" << endl;
+    }
+    else {
+        cout << "֤: ݲƥ" << endl;
+    }
+    cout << endl;
+
     // м
     start = chrono::high_resolution_clock::now();
     sm4.encryptParallel(bigData, encryptedData, BLOCK_COUNT);
@@ -446,16 +4019,270 @@ int main() {
     elapsed = end - start;
     cout << "м " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
         << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl << endl;
+
+    // н
+    start = chrono::high_resolution_clock::now();
+    sm4.decryptParallel(encryptedData, decryptedData, BLOCK_COUNT);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "н " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    if (memcmp(bigData, decryptedData, TEST_SIZE) == 0) {
+        cout << "н֤: ȫƥ" << endl;
+    }
+    else {
+        cout << "н֤: ݲƥ" << endl;
+    }
+    cout << endl;
+
+    // ߳ECB
+    start = chrono::high_resolution_clock::now();
+    sm4.encryptBulk(bigData, decryptedData, BLOCK_COUNT);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "̼߳ܣ" << dec << thread::hardware_concurrency() << "̣߳ " << hex
+        << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    if (memcmp(encryptedData, decryptedData, TEST_SIZE) == 0) {
+        cout << "̼֤߳: 벢мܽһ" << endl;
+    }
+    else {
+        cout << "̼֤߳: 벢мܽһ" << endl;
+    }
+    cout << endl;
+
+    // λƬܣʱ䣩
+    start = chrono::high_resolution_clock::now();
+    sm4.encryptBitsliced(bigData, decryptedData, BLOCK_COUNT);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "λƬ " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
     cout << ": " << fixed << setprecision(2)
         << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    if (memcmp(encryptedData, decryptedData, TEST_SIZE) == 0) {
+        cout << "λƬ֤: 벢мܽһ" << endl;
+    }
+    else {
+        cout << "λƬ֤: 벢мܽһ" << endl;
+    }
     cout << endl;
 
+    // CTRģʽ
+    unsigned char iv[16] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+    };
+    start = chrono::high_resolution_clock::now();
+    sm4.ctr_xcrypt(iv, bigData, encryptedData, TEST_SIZE);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "CTR " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    // ηǷĵýܣ֤õ
+    const size_t split = 1000003;
+    sm4.ctr_xcrypt(iv, encryptedData, decryptedData, split);
+    sm4.ctr_xcrypt(iv, encryptedData + split, decryptedData + split, TEST_SIZE - split, split);
     if (memcmp(bigData, decryptedData, TEST_SIZE) == 0) {
-        cout << "֤: ȫƥ" << endl;
+        cout << "CTR֤: ȫƥ" << endl;
     }
     else {
-        cout << "֤: ݲƥ" << endl;
+        cout << "CTR֤: ݲƥ" << endl;
+    }
+
+    // CBCģʽ
+    unsigned char cbcIv[16];
+    memcpy(cbcIv, iv, 16);
+    start = chrono::high_resolution_clock::now();
+    sm4.cbc_encrypt(cbcIv, bigData, encryptedData, BLOCK_COUNT);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "CBC " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    memcpy(cbcIv, iv, 16);
+    start = chrono::high_resolution_clock::now();
+    sm4.cbc_decrypt(cbcIv, encryptedData, decryptedData, BLOCK_COUNT);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "CBC " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+    if (memcmp(bigData, decryptedData, TEST_SIZE) == 0) {
+        cout << "CBC֤: ȫƥ" << endl;
+    }
+    else {
+        cout << "CBC֤: ݲƥ" << endl;
+    }
+
+    // 8·CBC֯ܣг8ΣΪ
+    unsigned char streamIv[8][16];
+    const unsigned char* streamIn[8];
+    unsigned char* streamOut[8];
+    size_t streamBlocks[8];
+    for (int k = 0; k < 8; k++) {
+        memcpy(streamIv[k], iv, 16);
+        streamIv[k][15] ^= k;
+        streamIn[k] = bigData + k * (TEST_SIZE / 8);
+        streamOut[k] = encryptedData + k * (TEST_SIZE / 8);
+        streamBlocks[k] = BLOCK_COUNT / 8;
+    }
+    start = chrono::high_resolution_clock::now();
+    sm4.cbc_encrypt8(streamIv, streamIn, streamOut, streamBlocks);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "8·CBC " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    for (int k = 0; k < 8; k++) {
+        memcpy(streamIv[k], iv, 16);
+        streamIv[k][15] ^= k;
+        sm4.cbc_decrypt(streamIv[k], streamOut[k], decryptedData + k * (TEST_SIZE / 8), streamBlocks[k]);
+    }
+    bool streamsMatch = memcmp(bigData, decryptedData, TEST_SIZE) == 0;
+    cout << "8·CBC֤: " << (streamsMatch ? "ȫƥ" : "ݲƥ") << endl;
+    cout << endl;
+
+    // SM4-GCMRFC 8998¼A.1֤ٲ
+    const unsigned char gcmKey[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10
+    };
+    const unsigned char gcmIv[12] = { 0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0xAB, 0xCD };
+    const unsigned char gcmAad[20] = {
+        0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+        0xAB, 0xAD, 0xDA, 0xD2
+    };
+    const unsigned char gcmTagExpected[16] = {
+        0x83, 0xDE, 0x35, 0x41, 0xE4, 0xC2, 0xB5, 0x81, 0x77, 0xE0, 0x65, 0xA9, 0xBF, 0x7B, 0x62, 0xEC
+    };
+    // Ϊÿ8ֽظһֽڣAA BB CC DD EE FF EE AA
+    const unsigned char gcmPattern[8] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF, 0xEE, 0xAA };
+    unsigned char gcmPlain[64], gcmCipher[64], gcmTag[16];
+    for (int i = 0; i < 64; i++) {
+        gcmPlain[i] = gcmPattern[i / 8];
+    }
+
+    SM4GCM gcm(gcmKey);
+    gcm.encrypt(gcmIv, 12, gcmAad, 20, gcmPlain, gcmCipher, 64, gcmTag);
+    cout << "GCMǩ: ";
+    for (int i = 0; i < 16; i++) {
+        cout << hex << setw(2) << setfill('0') << static_cast<int>(gcmTag[i]) << " ";
+    }
+    cout << endl;
+    cout << "GCM֤: " << (memcmp(gcmTag, gcmTagExpected, 16) == 0 ? "ǩһ" : "ǩһ") << endl;
+
+    start = chrono::high_resolution_clock::now();
+    gcm.encrypt(gcmIv, 12, gcmAad, 20, bigData, encryptedData, TEST_SIZE, gcmTag);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "GCM " << TEST_SIZE / (1024 * 1024) << "MB ݺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    bool gcmOk = gcm.decrypt(gcmIv, 12, gcmAad, 20, encryptedData, decryptedData, TEST_SIZE, gcmTag)
+        && memcmp(bigData, decryptedData, TEST_SIZE) == 0;
+    cout << "GCM֤: " << (gcmOk ? "ǩͨȫƥ" : "֤ʧ") << endl;
+    cout << endl;
+
+    // SM4-XTSݰ4KBһһȲ16ıŲã
+    const unsigned char xtsKey2[16] = {
+        0x0F, 0x1E, 0x2D, 0x3C, 0x4B, 0x5A, 0x69, 0x78, 0x87, 0x96, 0xA5, 0xB4, 0xC3, 0xD2, 0xE1, 0xF0
+    };
+    SM4XTS xts(key, xtsKey2);
+    const size_t SECTOR_SIZE = 4096;
+    const size_t sectorCount = TEST_SIZE / SECTOR_SIZE;
+    vector<SM4XTS::Sector> sectors(sectorCount);
+    for (size_t k = 0; k < sectorCount; k++) {
+        size_t len = (k + 1 == sectorCount) ? SECTOR_SIZE - 7 : SECTOR_SIZE;
+        sectors[k] = { 1000 + k, bigData + k * SECTOR_SIZE, encryptedData + k * SECTOR_SIZE, len };
+    }
+    start = chrono::high_resolution_clock::now();
+    xts.encryptSectors(sectors.data(), sectorCount);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "XTS " << TEST_SIZE / (1024 * 1024) << "MB ݣ4KBʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+
+    for (size_t k = 0; k < sectorCount; k++) {
+        sectors[k].input = encryptedData + k * SECTOR_SIZE;
+        sectors[k].output = decryptedData + k * SECTOR_SIZE;
+    }
+    xts.decryptSectors(sectors.data(), sectorCount);
+    bool xtsOk = memcmp(bigData, decryptedData, TEST_SIZE - 7) == 0;
+    cout << "XTS֤: " << (xtsOk ? "ȫƥ" : "ݲƥ") << endl;
+    cout << endl;
+
+    // ԿչԿܣbigDataǰKEY_COUNTΪԿ
+    // KEY_COUNTΪ¼ÿ¼ʹøԵԿ
+    const size_t KEY_COUNT = 100000;
+    vector<SM4KeySchedule> schedules(KEY_COUNT);
+    const unsigned char* recordKeys = bigData;
+    const unsigned char* records = bigData + KEY_COUNT * 16;
+
+    start = chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < KEY_COUNT; k++) {
+        SM4 perKey(recordKeys + k * 16);
+        perKey.encrypt(records + k * 16, decryptedData + k * 16);
+    }
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << " " << dec << KEY_COUNT << hex << " ¼ʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+
+    start = chrono::high_resolution_clock::now();
+    SM4::expandKeys(recordKeys, schedules.data(), KEY_COUNT);
+    SM4::encryptMultiKey(schedules.data(), records, encryptedData, KEY_COUNT);
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "Կչ + Կܺʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    bool multiKeyOk = memcmp(encryptedData, decryptedData, KEY_COUNT * 16) == 0;
+    cout << "Կ֤: " << (multiKeyOk ? "һ" : "ܲһ") << endl;
+    cout << endl;
+
+    // ɢ/ۼӿڣг1500ֽڵıĶΣԭCTRܺܵĽȽ
+    const size_t SEGMENT_SIZE = 1500;
+    memcpy(decryptedData, bigData, TEST_SIZE);
+    vector<SM4IoVec> segments;
+    for (size_t pos = 0; pos < TEST_SIZE; pos += SEGMENT_SIZE) {
+        segments.push_back({ decryptedData + pos, min(SEGMENT_SIZE, TEST_SIZE - pos) });
     }
+    start = chrono::high_resolution_clock::now();
+    sm4.ctr_xcrypt_iov(iv, segments.data(), segments.size());
+    end = chrono::high_resolution_clock::now();
+    elapsed = end - start;
+    cout << "ֶCTR " << TEST_SIZE / (1024 * 1024) << "MB ݣ1500ֽһΣʱ: "
+        << fixed << setprecision(3) << elapsed.count() << " " << endl;
+    cout << ": " << fixed << setprecision(2)
+        << (TEST_SIZE / (1024.0 * 1024.0) / elapsed.count()) << " MB/s" << endl;
+    sm4.ctr_xcrypt(iv, bigData, encryptedData, TEST_SIZE);
+    bool iovOk = memcmp(encryptedData, decryptedData, TEST_SIZE) == 0;
+    cout << "ֶCTR֤: " << (iovOk ? "һ" : "ܲһ") << endl;
+
+#ifdef SM4_INSTRUMENT
+    cout << "\n=== ʱͳ ===" << endl;
+    cout << SM4Metrics::exportText();
+#endif
 
     delete[] bigData;
     delete[] encryptedData;
@@ -15,6 +15,8 @@ private:
 
     // 32Կ
     unsigned int roundKeys[32];
+    // Կã
+    unsigned int decRoundKeys[32];
 
     // ѭ
     static inline unsigned int leftRotate(unsigned int word, unsigned int bits) {
@@ -77,16 +79,15 @@ private:
             kx[i + 4] = kx[i] ^ tTransformPrime(kx[i + 1] ^ kx[i + 2] ^ kx[i + 3] ^ CK[i]);
             roundKeys[i] = kx[i + 4];
         }
-    }
 
-public:
-    // 캯
-    SM4(const unsigned char key[16]) {
-        keySchedule(key);
+        // ԿΪԿԿչʱһ
+        for (int i = 0; i < 32; i++) {
+            decRoundKeys[i] = roundKeys[31 - i];
+        }
     }
 
-    // 
-    void encrypt(const unsigned char input[16], unsigned char output[16]) {
+    // ӽܣrkԿ˳
+    static void crypt(const unsigned char input[16], unsigned char output[16], const unsigned int rk[32]) {
         // ֳ432λ֣
         unsigned int x[4];
         for (int i = 0; i < 4; i++) {
@@ -96,7 +97,7 @@ public:
 
         // 32ֵ
         for (int i = 0; i < 32; i++) {
-            unsigned int temp = x[0] ^ tTransform(x[1] ^ x[2] ^ x[3] ^ roundKeys[i]);
+            unsigned int temp = x[0] ^ tTransform(x[1] ^ x[2] ^ x[3] ^ rk[i]);
             // ״̬
             x[0] = x[1];
             x[1] = x[2];
@@ -114,26 +115,20 @@ public:
         }
     }
 
-    // 
-    void decrypt(const unsigned char input[16], unsigned char output[16]) {
-        // ʹԿ
-        unsigned int reverseKeys[32];
-        for (int i = 0; i < 32; i++) {
-            reverseKeys[i] = roundKeys[31 - i];
-        }
-
-        // ʱԭʼԿ
-        unsigned int tempKeys[32];
-        memcpy(tempKeys, roundKeys, sizeof(roundKeys));
-
-        // ʹԿ
-        memcpy(roundKeys, reverseKeys, sizeof(reverseKeys));
+public:
+    // 캯
+    SM4(const unsigned char key[16]) {
+        keySchedule(key);
+    }
 
-        // 
-        encrypt(input, output);
+    // 
+    void encrypt(const unsigned char input[16], unsigned char output[16]) const {
+        crypt(input, output, roundKeys);
+    }
 
-        // ָԭʼԿ
-        memcpy(roundKeys, tempKeys, sizeof(roundKeys));
+    // 
+    void decrypt(const unsigned char input[16], unsigned char output[16]) const {
+        crypt(input, output, decRoundKeys);
     }
 };
 
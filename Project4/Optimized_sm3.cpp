@@ -3,11 +3,107 @@
 #include <cstdint>
 #include <iomanip>
 #include <string>
-#include <sstream>
 #include <ctime>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <array>
+#include <type_traits>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <cstdio>
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#include <filesystem>
+#else
+#include <unistd.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SM3_TARGET(features)
+#define SM3_FLATTEN
+#define SM3_INLINE __forceinline
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+// GCC/Clang°ָļԻx86-64뼴
+#define SM3_TARGET(features) __attribute__((target(features)))
+#define SM3_FLATTEN __attribute__((flatten))
+#define SM3_INLINE __attribute__((always_inline)) inline
+#ifndef __clang__
+// ໺ģ徭flattentargetԵУABI
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+#endif
 
 using namespace std;
 
+// ȡCPUID
+static inline void cpuidex(unsigned int leaf, unsigned int subleaf, unsigned int r[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int t[4];
+    __cpuidex(t, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; i++) {
+        r[i] = static_cast<unsigned int>(t[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// ȡXCR0ϵͳǷ񱣴YMM/ZMMĴ״̬
+static inline unsigned long long xgetbv0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+}
+
+// CPU
+struct CpuFeatures {
+    bool avx2;
+    bool bmi2;
+    bool avx512f;
+};
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures f = { false, false, false };
+    unsigned int r0[4], r1[4], r7[4];
+    cpuidex(0, 0, r0);
+    if (r0[0] < 7) {
+        return f;
+    }
+    cpuidex(1, 0, r1);
+    cpuidex(7, 0, r7);
+
+    // AVXָҪϵͳOSXSAVEӦļĴ״̬
+    bool osxsave = (r1[2] >> 27) & 1;
+    unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    bool ymm = (xcr0 & 0x06) == 0x06;
+    bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+    f.avx2 = ymm && ((r1[2] >> 28) & 1) && ((r7[1] >> 5) & 1);
+    f.bmi2 = (r7[1] >> 8) & 1;
+    f.avx512f = zmm && f.avx2 && ((r7[1] >> 16) & 1);
+    return f;
+}
+
+// ֻ״ʹʱ̽һ
+static const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures f = detectCpuFeatures();
+    return f;
+}
+
 // ѭ
 inline uint32_t ROL(uint32_t x, uint32_t n) {
     return (x << (n & 0x1F)) | (x >> ((32 - n) & 0x1F));
@@ -23,84 +119,28 @@ inline uint32_t ROL(uint32_t x, uint32_t n) {
 #define P0(X) ((X) ^ ROL(X, 9) ^ ROL(X, 17))
 #define P1(X) ((X) ^ ROL(X, 15) ^ ROL(X, 23))
 
-class SM3 {
-public:
-    SM3() { reset(); }
-
-    void reset() {
-        state[0] = 0x7380166F;
-        state[1] = 0x4914B2B9;
-        state[2] = 0x172442D7;
-        state[3] = 0xDA8A0600;
-        state[4] = 0xA96F30BC;
-        state[5] = 0x163138AA;
-        state[6] = 0xE38DEE4D;
-        state[7] = 0xB0FB0E4E;
-        total_len = 0;
-        buffer.clear();
-        buffer.reserve(64);  
-    }
-
-    void update(const uint8_t* data, size_t len) {
-        total_len += len;
-        size_t offset = 0;
-
-        // е
-        if (!buffer.empty()) {
-            size_t fill = min(64 - buffer.size(), len);
-            buffer.insert(buffer.end(), data, data + fill);
-            offset += fill;
-
-            if (buffer.size() == 64) {
-                process_block(buffer.data());
-                buffer.clear();
-            }
-        }
-
-        // 
-        while (offset + 64 <= len) {
-            process_block(data + offset);
-            offset += 64;
-        }
-
-        // ʣ
-        if (offset < len) {
-            buffer.insert(buffer.end(), data + offset, data + len);
-        }
-    }
-
-    void finalize() {
-        uint64_t bit_len = total_len * 8;
-
-        // 
-        buffer.push_back(0x80);
-        size_t len_mod = buffer.size() % 64;
-        size_t padding_len = (len_mod <= 56) ? (56 - len_mod) : (120 - len_mod);
-        buffer.insert(buffer.end(), padding_len, 0);
-
-        // ӳ
-        for (int i = 7; i >= 0; --i) {
-            buffer.push_back(static_cast<uint8_t>((bit_len >> (i * 8)) & 0xFF));
-        }
-
-        // 
-        for (size_t i = 0; i < buffer.size(); i += 64) {
-            process_block(buffer.data() + i);
-        }
-        buffer.clear();
+// ֳROL(Tj, j mod 32)ڼ
+static constexpr array<uint32_t, 64> buildRoundConstants() {
+    array<uint32_t, 64> t = {};
+    for (int j = 0; j < 64; j++) {
+        uint32_t tj = j < 16 ? 0x79CC4519 : 0x7A879D8A;
+        int n = j % 32;
+        t[j] = n == 0 ? tj : (tj << n) | (tj >> (32 - n));
     }
+    return t;
+}
+static constexpr array<uint32_t, 64> SM3_T = buildRoundConstants();
 
-    string digest() {
-        stringstream ss;
-        ss << hex << setfill('0');
-        for (int i = 0; i < 8; ++i) {
-            ss << setw(8) << state[i];
-        }
-        return ss.str();
-    }
+// ʼֵIV
+static const uint32_t SM3_IV[8] = {
+    0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
+    0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+};
 
-private:
-    void process_block(const uint8_t* block) {
+// ѹδnumBlocks64ֽڷ
+static SM3_INLINE void compressBlocks(uint32_t st[8], const uint8_t* data, size_t numBlocks) {
+    for (size_t n = 0; n < numBlocks; n++, data += 64) {
+        const uint8_t* block = data;
         // Ϣչ
         uint32_t W[68];
         uint32_t W1[64];
@@ -125,14 +165,14 @@ private:
         }
 
         // Ĵ
-        uint32_t A = state[0];
-        uint32_t B = state[1];
-        uint32_t C = state[2];
-        uint32_t D = state[3];
-        uint32_t E = state[4];
-        uint32_t F = state[5];
-        uint32_t G = state[6];
-        uint32_t H = state[7];
+        uint32_t A = st[0];
+        uint32_t B = st[1];
+        uint32_t C = st[2];
+        uint32_t D = st[3];
+        uint32_t E = st[4];
+        uint32_t F = st[5];
+        uint32_t G = st[6];
+        uint32_t H = st[7];
 
         // ѭչ 
         for (int j = 0; j < 64; ++j) {
@@ -164,21 +204,705 @@ private:
         }
 
         // ״̬
-        state[0] ^= A;
-        state[1] ^= B;
-        state[2] ^= C;
-        state[3] ^= D;
-        state[4] ^= E;
-        state[5] ^= F;
-        state[6] ^= G;
-        state[7] ^= H;
+        st[0] ^= A;
+        st[1] ^= B;
+        st[2] ^= C;
+        st[3] ^= D;
+        st[4] ^= E;
+        st[5] ^= F;
+        st[6] ^= G;
+        st[7] ^= H;
+    }
+}
+
+// ָµѹʵ
+static void compressScalar(uint32_t st[8], const uint8_t* data, size_t numBlocks) {
+    compressBlocks(st, data, numBlocks);
+}
+
+// ==================== ·Żѹ ====================
+// ϢչÿSSE4֣W[j+3]ͬһW[j]ȰW[j] = 0㣬
+// P1ԲP1(ROL(W[j], 15))64ְΪ0-1516-63ȫչ
+// ֳȡԱڱW'㣻ÿֻͨĴĸֵ
+
+// 128λи32λѭ
+#define SM3_ROL128(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+// һ֣дDHBFԭѭλһְ(D, A, B, C, H, E, F, G)˳
+#define SM3_ROUND(A, B, C, D, E, F, G, H, j, FF, GG) do { \
+        uint32_t a12 = ROL(A, 12); \
+        uint32_t ss1 = ROL(a12 + E + SM3_T[j], 7); \
+        uint32_t ss2 = ss1 ^ a12; \
+        uint32_t tt1 = FF(A, B, C) + D + ss2 + (W[j] ^ W[(j) + 4]); \
+        uint32_t tt2 = GG(E, F, G) + H + ss1 + W[j]; \
+        B = ROL(B, 9); \
+        F = ROL(F, 19); \
+        D = tt1; \
+        H = P0(tt2); \
+    } while (0)
+
+// 4֣ʱصʼ˳
+#define SM3_ROUND4(j, FF, GG) \
+    SM3_ROUND(A, B, C, D, E, F, G, H, (j), FF, GG); \
+    SM3_ROUND(D, A, B, C, H, E, F, G, (j) + 1, FF, GG); \
+    SM3_ROUND(C, D, A, B, G, H, E, F, (j) + 2, FF, GG); \
+    SM3_ROUND(B, C, D, A, F, G, H, E, (j) + 3, FF, GG)
+
+SM3_TARGET("avx2,bmi2")
+static void compressAVX2(uint32_t st[8], const uint8_t* data, size_t numBlocks) {
+    const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    uint32_t A = st[0], B = st[1], C = st[2], D = st[3];
+    uint32_t E = st[4], F = st[5], G = st[6], H = st[7];
+    for (size_t n = 0; n < numBlocks; n++, data += 64) {
+        alignas(16) uint32_t W[68];
+        for (int i = 0; i < 16; i += 4) {
+            __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+            _mm_store_si128(reinterpret_cast<__m128i*>(W + i), _mm_shuffle_epi8(m, bswap));
+        }
+        for (int j = 16; j < 68; j += 4) {
+            __m128i w16 = _mm_load_si128(reinterpret_cast<const __m128i*>(W + j - 16));
+            __m128i w13 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(W + j - 13));
+            __m128i w9 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(W + j - 9));
+            __m128i w6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(W + j - 6));
+            // W[j-3..j-1]0
+            __m128i w3 = _mm_srli_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(W + j - 4)), 4);
+
+            __m128i x = _mm_xor_si128(_mm_xor_si128(w16, w9), SM3_ROL128(w3, 15));
+            x = _mm_xor_si128(_mm_xor_si128(x, SM3_ROL128(x, 15)), SM3_ROL128(x, 23));
+            x = _mm_xor_si128(_mm_xor_si128(x, SM3_ROL128(w13, 7)), w6);
+
+            // 4ֲW[j]Ĺ
+            __m128i u = SM3_ROL128(_mm_slli_si128(x, 12), 15);
+            u = _mm_xor_si128(_mm_xor_si128(u, SM3_ROL128(u, 15)), SM3_ROL128(u, 23));
+            _mm_store_si128(reinterpret_cast<__m128i*>(W + j), _mm_xor_si128(x, u));
+        }
+
+        SM3_ROUND4(0, FF0, GG0);
+        SM3_ROUND4(4, FF0, GG0);
+        SM3_ROUND4(8, FF0, GG0);
+        SM3_ROUND4(12, FF0, GG0);
+
+        SM3_ROUND4(16, FF1, GG1);
+        SM3_ROUND4(20, FF1, GG1);
+        SM3_ROUND4(24, FF1, GG1);
+        SM3_ROUND4(28, FF1, GG1);
+        SM3_ROUND4(32, FF1, GG1);
+        SM3_ROUND4(36, FF1, GG1);
+        SM3_ROUND4(40, FF1, GG1);
+        SM3_ROUND4(44, FF1, GG1);
+        SM3_ROUND4(48, FF1, GG1);
+        SM3_ROUND4(52, FF1, GG1);
+        SM3_ROUND4(56, FF1, GG1);
+        SM3_ROUND4(60, FF1, GG1);
+
+        A = st[0] ^= A;
+        B = st[1] ^= B;
+        C = st[2] ^= C;
+        D = st[3] ^= D;
+        E = st[4] ^= E;
+        F = st[5] ^= F;
+        G = st[6] ^= G;
+        H = st[7] ^= H;
+    }
+}
+
+// ==================== ໺ѹ ====================
+// 8/16Ϣռһ32λSIMDͨͬʱѹԵһ飺
+// ״̬תôţst[k * LANES + l]Ϊl·ĵk״̬
+
+// ˶ȡ32λ
+static inline uint32_t loadBE32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+        | (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+// д32λ
+static inline void storeBE32(uint8_t* p, uint32_t x) {
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+// AVX28·
+struct LanesAVX2 {
+    typedef __m256i V;
+    static const unsigned LANES = 8;
+    SM3_TARGET("avx2") static inline V load(const uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    SM3_TARGET("avx2") static inline void store(uint32_t* p, V x) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), x); }
+    SM3_TARGET("avx2") static inline V set1(uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    SM3_TARGET("avx2") static inline V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    SM3_TARGET("avx2") static inline V xor2(V a, V b) { return _mm256_xor_si256(a, b); }
+    SM3_TARGET("avx2") static inline V xor3(V a, V b, V c) { return _mm256_xor_si256(_mm256_xor_si256(a, b), c); }
+    // FF1
+    SM3_TARGET("avx2") static inline V maj(V a, V b, V c) {
+        return _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    }
+    // GG1xѡyz
+    SM3_TARGET("avx2") static inline V choose(V x, V y, V z) {
+        return _mm256_or_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z));
+    }
+    template <int N>
+    SM3_TARGET("avx2") static inline V rol(V x) { return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N)); }
+};
+
+// AVX-51216·ѭλ߼һָ
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC 12avx512fintrin.h_mm512_rol_epi32δʼ__Yֱֵͨ
+// -Wuninitialized/-Wmaybe-uninitialized󱨣GCC bug 105593ڴ˴
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+struct LanesAVX512 {
+    typedef __m512i V;
+    static const unsigned LANES = 16;
+    SM3_TARGET("avx512f") static inline V load(const uint32_t* p) { return _mm512_load_si512(p); }
+    SM3_TARGET("avx512f") static inline void store(uint32_t* p, V x) { _mm512_store_si512(p, x); }
+    SM3_TARGET("avx512f") static inline V set1(uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    SM3_TARGET("avx512f") static inline V add(V a, V b) { return _mm512_add_epi32(a, b); }
+    SM3_TARGET("avx512f") static inline V xor2(V a, V b) { return _mm512_xor_si512(a, b); }
+    SM3_TARGET("avx512f") static inline V xor3(V a, V b, V c) { return _mm512_ternarylogic_epi32(a, b, c, 0x96); }
+    SM3_TARGET("avx512f") static inline V maj(V a, V b, V c) { return _mm512_ternarylogic_epi32(a, b, c, 0xE8); }
+    SM3_TARGET("avx512f") static inline V choose(V x, V y, V z) { return _mm512_ternarylogic_epi32(x, y, z, 0xCA); }
+    template <int N>
+    SM3_TARGET("avx512f") static inline V rol(V x) { return _mm512_rol_epi32(x, N); }
+};
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// ໺һ֣FF/GGΪöεĲLĳԱ
+#define SM3_LANE_ROUND(j, FF, GG) do { \
+        V a12 = L::template rol<12>(A); \
+        V ss1 = L::template rol<7>(L::add(L::add(a12, E), L::set1(SM3_T[j]))); \
+        V ss2 = L::xor2(ss1, a12); \
+        V tt1 = L::add(L::add(L::add(D, ss2), L::xor2(W[j], W[(j) + 4])), FF(A, B, C)); \
+        V tt2 = L::add(L::add(L::add(H, ss1), W[j]), GG(E, F, G)); \
+        D = C; \
+        C = L::template rol<9>(B); \
+        B = A; \
+        A = tt1; \
+        H = G; \
+        G = L::template rol<19>(F); \
+        F = E; \
+        E = L::xor3(tt2, L::template rol<9>(tt2), L::template rol<17>(tt2)); \
+    } while (0)
+
+// ໺ѹblocks[l]Ϊl·ѹ64ֽڷ
+template <typename L>
+static SM3_INLINE void compressLanes(uint32_t* st, const uint8_t* const* blocks) {
+    typedef typename L::V V;
+    const unsigned N = L::LANES;
+
+    // ·ϢתΪW[i]ĵlͨ
+    alignas(64) uint32_t m[16 * N];
+    for (unsigned l = 0; l < N; l++) {
+        for (int i = 0; i < 16; i++) {
+            m[i * N + l] = loadBE32(blocks[l] + i * 4);
+        }
+    }
+    V W[68];
+    for (int i = 0; i < 16; i++) {
+        W[i] = L::load(m + i * N);
+    }
+    for (int j = 16; j < 68; j++) {
+        V x = L::xor3(W[j - 16], W[j - 9], L::template rol<15>(W[j - 3]));
+        x = L::xor3(x, L::template rol<15>(x), L::template rol<23>(x));
+        W[j] = L::xor3(x, L::template rol<7>(W[j - 13]), W[j - 6]);
+    }
+
+    V A = L::load(st), B = L::load(st + N), C = L::load(st + 2 * N), D = L::load(st + 3 * N);
+    V E = L::load(st + 4 * N), F = L::load(st + 5 * N), G = L::load(st + 6 * N), H = L::load(st + 7 * N);
+
+    // ǰ1648ֵĲֳͬαڷ֧
+    for (int j = 0; j < 16; j++) {
+        SM3_LANE_ROUND(j, L::xor3, L::xor3);
+    }
+    for (int j = 16; j < 64; j++) {
+        SM3_LANE_ROUND(j, L::maj, L::choose);
+    }
+
+    L::store(st, L::xor2(L::load(st), A));
+    L::store(st + N, L::xor2(L::load(st + N), B));
+    L::store(st + 2 * N, L::xor2(L::load(st + 2 * N), C));
+    L::store(st + 3 * N, L::xor2(L::load(st + 3 * N), D));
+    L::store(st + 4 * N, L::xor2(L::load(st + 4 * N), E));
+    L::store(st + 5 * N, L::xor2(L::load(st + 5 * N), F));
+    L::store(st + 6 * N, L::xor2(L::load(st + 6 * N), G));
+    L::store(st + 7 * N, L::xor2(L::load(st + 7 * N), H));
+}
+
+SM3_TARGET("avx2") SM3_FLATTEN
+static void compressLanesAVX2(uint32_t* st, const uint8_t* const* blocks) {
+    compressLanes<LanesAVX2>(st, blocks);
+}
+
+SM3_TARGET("avx512f") SM3_FLATTEN
+static void compressLanesAVX512(uint32_t* st, const uint8_t* const* blocks) {
+    compressLanes<LanesAVX512>(st, blocks);
+}
+
+// ѹʵַʽ
+enum class SM3Impl {
+    Scalar, // ʵ
+    AVX2,   // ·SSEϢչ + չֺ໺壺8·
+    AVX512  // 16·໺壨໺壩
+};
+
+// ѹĺָ
+struct SM3Kernels {
+    SM3Impl impl;
+    const char* id;     // Ӣıʶܲ
+    const char* name;
+    void (*compress)(uint32_t st[8], const uint8_t* data, size_t numBlocks);
+};
+
+// ״ʹʱCPUѡʵ֣֮еö˱
+static const SM3Kernels* sm3CompressKernel(SM3Impl impl) {
+    static const SM3Kernels scalar = { SM3Impl::Scalar, "scalar", "", compressScalar };
+    static const SM3Kernels avx2 = { SM3Impl::AVX2, "avx2", "SIMDϢչ", compressAVX2 };
+    return impl == SM3Impl::Scalar ? &scalar : &avx2;
+}
+
+// ·ѹǷָʵ֣AVX-512ûеĵ·ʵ֣
+static bool sm3CompressSupported(SM3Impl impl) {
+    switch (impl) {
+    case SM3Impl::AVX2:
+        return cpuFeatures().avx2 && cpuFeatures().bmi2;
+    case SM3Impl::AVX512:
+        return false;
+    default:
+        return true;
+    }
+}
+
+static const SM3Kernels& sm3Compress() {
+    static const SM3Kernels* best =
+        sm3CompressKernel(sm3CompressSupported(SM3Impl::AVX2) ? SM3Impl::AVX2 : SM3Impl::Scalar);
+    return *best;
+}
+
+// ໺ѹlanesΪͬʱϢʵΪ1Ϣ㣩
+struct SM3LaneKernels {
+    SM3Impl impl;
+    const char* id;
+    const char* name;
+    unsigned lanes;
+    void (*compressLanes)(uint32_t* st, const uint8_t* const* blocks);
+};
+
+// ǰCPUǷָ֧Ķ໺ʵ
+static bool sm3ImplSupported(SM3Impl impl) {
+    switch (impl) {
+    case SM3Impl::AVX2:
+        return cpuFeatures().avx2;
+    case SM3Impl::AVX512:
+        return cpuFeatures().avx512f;
+    default:
+        return true;
+    }
+}
+
+static const SM3LaneKernels* sm3LaneKernels(SM3Impl impl) {
+    static const SM3LaneKernels tables[] = {
+        { SM3Impl::Scalar, "scalar", "", 1, nullptr },
+        { SM3Impl::AVX2, "avx2", "AVX2 8·", 8, compressLanesAVX2 },
+        { SM3Impl::AVX512, "avx512", "AVX-512 16·", 16, compressLanesAVX512 },
+    };
+    return &tables[static_cast<int>(impl)];
+}
+
+//  AVX-512 > AVX2 >  ˳ѡ
+static SM3Impl sm3BestLaneImpl() {
+    static const SM3Impl best =
+        sm3ImplSupported(SM3Impl::AVX512) ? SM3Impl::AVX512 :
+        sm3ImplSupported(SM3Impl::AVX2) ? SM3Impl::AVX2 : SM3Impl::Scalar;
+    return best;
+}
+
+#ifdef SM3_INSTRUMENT
+// ==================== ʱͳƣʱSM3_INSTRUMENTã ====================
+// ÿ߳һݼֻ߳д룬ʱ̣߳
+// δSM3_INSTRUMENTʱSM3_TRACE
+
+// ͳƵĲupdate/finalizeΪӿڵãcompressΪÿηɵѹ
+// multi_bufferΪһζ໺
+enum class SM3Op { Update, Finalize, Compress, MultiBuffer, Count };
+
+class SM3Metrics {
+public:
+    static const int OPS = static_cast<int>(SM3Op::Count);
+    static const int IMPLS = 3;
+    static const int BUCKETS = 40;  // ӳֱͼiͰΪ[2^i, 2^(i+1))TSC
+
+    // ٻصÿεýʱڵִ߳Уб֤̰߳ȫ
+    typedef void (*TraceHook)(SM3Op op, SM3Impl impl, size_t bytes, unsigned long long cycles);
+
+    static void record(SM3Op op, SM3Impl impl, size_t bytes, unsigned long long cycles) {
+        ThreadStats& s = local();
+        int o = static_cast<int>(op);
+        bump(s.calls[o], 1);
+        bump(s.bytes[o], bytes);
+        bump(s.cycles[o], cycles);
+        bump(s.hist[o][bucketOf(cycles)], 1);
+        if (op == SM3Op::Compress || op == SM3Op::MultiBuffer) {
+            bump(s.implCalls[static_cast<int>(impl)], 1);
+            if (impl == SM3Impl::Scalar) {
+                bump(s.fallback, 1);
+            }
+        }
+        TraceHook h = hook().load(memory_order_relaxed);
+        if (h) {
+            h(op, impl, bytes, cycles);
+        }
+    }
+
+    // øٻصnullptrΪر
+    static void setTraceHook(TraceHook h) {
+        hook().store(h, memory_order_relaxed);
+    }
+
+    // ̵߳ļPrometheusıʽ
+    static string exportText() {
+        static const char* const opNames[OPS] = { "update", "finalize", "compress", "multi_buffer" };
+        static const char* const implNames[IMPLS] = { "scalar", "avx2", "avx512" };
+
+        unsigned long long calls[OPS] = {}, bytes[OPS] = {}, cycles[OPS] = {}, hist[OPS][BUCKETS] = {};
+        unsigned long long implCalls[IMPLS] = {}, fallback = 0;
+        size_t threads;
+        {
+            lock_guard<mutex> lock(registryMutex());
+            threads = registry().size();
+            for (const unique_ptr<ThreadStats>& t : registry()) {
+                for (int o = 0; o < OPS; o++) {
+                    calls[o] += t->calls[o].load(memory_order_relaxed);
+                    bytes[o] += t->bytes[o].load(memory_order_relaxed);
+                    cycles[o] += t->cycles[o].load(memory_order_relaxed);
+                    for (int b = 0; b < BUCKETS; b++) {
+                        hist[o][b] += t->hist[o][b].load(memory_order_relaxed);
+                    }
+                }
+                for (int i = 0; i < IMPLS; i++) {
+                    implCalls[i] += t->implCalls[i].load(memory_order_relaxed);
+                }
+                fallback += t->fallback.load(memory_order_relaxed);
+            }
+        }
+
+        string out;
+        out += "# TYPE sm3_calls_total counter\n";
+        for (int o = 0; o < OPS; o++) {
+            out += "sm3_calls_total{op=\"" + string(opNames[o]) + "\"} " + to_string(calls[o]) + "\n";
+        }
+        out += "# TYPE sm3_bytes_total counter\n";
+        for (int o = 0; o < OPS; o++) {
+            out += "sm3_bytes_total{op=\"" + string(opNames[o]) + "\"} " + to_string(bytes[o]) + "\n";
+        }
+        out += "# TYPE sm3_backend_calls_total counter\n";
+        for (int i = 0; i < IMPLS; i++) {
+            out += "sm3_backend_calls_total{impl=\"" + string(implNames[i]) + "\"} " + to_string(implCalls[i]) + "\n";
+        }
+        out += "# TYPE sm3_scalar_fallback_total counter\n";
+        out += "sm3_scalar_fallback_total " + to_string(fallback) + "\n";
+        out += "# TYPE sm3_threads gauge\n";
+        out += "sm3_threads " + to_string(threads) + "\n";
+        // ֻеõĲͰϽleΪΪۼֵ
+        out += "# TYPE sm3_latency_cycles histogram\n";
+        for (int o = 0; o < OPS; o++) {
+            if (calls[o] == 0) {
+                continue;
+            }
+            string label = "op=\"" + string(opNames[o]) + "\"";
+            unsigned long long cumulative = 0;
+            for (int b = 0; b < BUCKETS; b++) {
+                cumulative += hist[o][b];
+                out += "sm3_latency_cycles_bucket{" + label + ",le=\"" + to_string(2ULL << b) + "\"} "
+                    + to_string(cumulative) + "\n";
+            }
+            out += "sm3_latency_cycles_bucket{" + label + ",le=\"+Inf\"} " + to_string(calls[o]) + "\n";
+            out += "sm3_latency_cycles_sum{" + label + "} " + to_string(cycles[o]) + "\n";
+            out += "sm3_latency_cycles_count{" + label + "} " + to_string(calls[o]) + "\n";
+        }
+        return out;
+    }
+
+    // ̵߳ļ
+    static void reset() {
+        lock_guard<mutex> lock(registryMutex());
+        for (const unique_ptr<ThreadStats>& t : registry()) {
+            for (int o = 0; o < OPS; o++) {
+                t->calls[o].store(0, memory_order_relaxed);
+                t->bytes[o].store(0, memory_order_relaxed);
+                t->cycles[o].store(0, memory_order_relaxed);
+                for (int b = 0; b < BUCKETS; b++) {
+                    t->hist[o][b].store(0, memory_order_relaxed);
+                }
+            }
+            for (int i = 0; i < IMPLS; i++) {
+                t->implCalls[i].store(0, memory_order_relaxed);
+            }
+            t->fallback.store(0, memory_order_relaxed);
+        }
+    }
+
+private:
+    // ̵߳ļɵǼǱУ߳˳Լ뵼
+    struct alignas(64) ThreadStats {
+        atomic<unsigned long long> calls[OPS];
+        atomic<unsigned long long> bytes[OPS];
+        atomic<unsigned long long> cycles[OPS];
+        atomic<unsigned long long> hist[OPS][BUCKETS];
+        atomic<unsigned long long> implCalls[IMPLS];
+        atomic<unsigned long long> fallback;
+    };
+
+    // ֻ߳д룬ҪԭӵĶ--д
+    static inline void bump(atomic<unsigned long long>& c, unsigned long long n) {
+        c.store(c.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+
+    static inline int bucketOf(unsigned long long cycles) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long b;
+        _BitScanReverse64(&b, cycles | 1);
+        int bucket = static_cast<int>(b);
+#else
+        int bucket = 63 - __builtin_clzll(cycles | 1);
+#endif
+        return bucket < BUCKETS ? bucket : BUCKETS - 1;
+    }
+
+    static mutex& registryMutex() {
+        static mutex m;
+        return m;
+    }
+
+    static vector<unique_ptr<ThreadStats>>& registry() {
+        static vector<unique_ptr<ThreadStats>> r;
+        return r;
+    }
+
+    static atomic<TraceHook>& hook() {
+        static atomic<TraceHook> h(nullptr);
+        return h;
+    }
+
+    static ThreadStats& local() {
+        thread_local ThreadStats* stats = nullptr;
+        if (!stats) {
+            unique_ptr<ThreadStats> t(new ThreadStats());
+            stats = t.get();
+            lock_guard<mutex> lock(registryMutex());
+            registry().push_back(move(t));
+        }
+        return *stats;
+    }
+};
+
+// ʱʱTSCʱ¼һε
+class SM3Trace {
+public:
+    SM3Trace(SM3Op op, SM3Impl impl, size_t bytes) : op(op), impl(impl), bytes(bytes), start(__rdtsc()) {}
+    ~SM3Trace() {
+        SM3Metrics::record(op, impl, bytes, __rdtsc() - start);
+    }
+    SM3Trace(const SM3Trace&) = delete;
+    SM3Trace& operator=(const SM3Trace&) = delete;
+private:
+    SM3Op op;
+    SM3Impl impl;
+    size_t bytes;
+    unsigned long long start;
+};
+
+#define SM3_TRACE(op, impl, bytes) SM3Trace sm3Trace(SM3Op::op, (impl), (bytes))
+#else
+#define SM3_TRACE(op, impl, bytes)
+#endif
+
+// ĿգֵѴֽδķ飬̶112ֽڣֶδ˴ţ
+// ƽ̨ͱ޹أֱдļݿ⣬ָ
+//   0..3    "SM3C"
+//   4       汾ţ1
+//   5..7    Ϊ0
+//   8..15   Ѵֽ
+//   16..47  ֵ832λ֣
+//   48..111 δݣΪѴֽ % 64Ϊ0
+struct SM3Snapshot {
+    static const size_t SIZE = 112;
+    static const uint8_t VERSION = 1;
+    uint8_t bytes[SIZE];
+};
+
+// ֻжĳԱ״̬64ֽڵķ黺κζѷ䣬
+// ԰ֵƣԹǰ׺һκģٷֱ׷Ӳͬĺ׺
+class SM3 {
+public:
+    SM3() { reset(); }
+
+    // ӷ߽紦chainΪǰprefixLenֽڣΪ64ıֵ
+    SM3(const uint32_t chain[8], uint64_t prefixLen) {
+        memcpy(state, chain, sizeof(state));
+        total_len = prefixLen;
+    }
+
+    void reset() {
+        memcpy(state, SM3_IV, sizeof(state));
+        total_len = 0;
+    }
+
+    void update(const uint8_t* data, size_t len) {
+        SM3_TRACE(Update, sm3Compress().impl, len);
+        size_t buffered = static_cast<size_t>(total_len % 64);
+        total_len += len;
+        size_t offset = 0;
+
+        // Ȳе
+        if (buffered != 0 && len > 0) {
+            size_t fill = min(64 - buffered, len);
+            memcpy(buffer + buffered, data, fill);
+            offset += fill;
+            if (buffered + fill < 64) {
+                return;
+            }
+            process_block(buffer);
+        }
+
+        // 飨һεôȫ飩
+        size_t blocks = (len - offset) / 64;
+        if (blocks > 0) {
+            SM3_TRACE(Compress, sm3Compress().impl, blocks * 64);
+            sm3Compress().compress(state, data + offset, blocks);
+            offset += blocks * 64;
+        }
+
+        // ʣ
+        if (offset < len) {
+            memcpy(buffer, data + offset, len - offset);
+        }
+    }
+
+    // ڻԭ䲢12
+    void finalize() {
+        size_t buffered = static_cast<size_t>(total_len % 64);
+        SM3_TRACE(Finalize, sm3Compress().impl, buffered);
+        uint64_t bit_len = total_len * 8;
+
+        buffer[buffered++] = 0x80;
+        if (buffered > 56) {
+            memset(buffer + buffered, 0, 64 - buffered);
+            process_block(buffer);
+            buffered = 0;
+        }
+        memset(buffer + buffered, 0, 56 - buffered);
+
+        // ӳ
+        for (int i = 0; i < 8; ++i) {
+            buffer[56 + i] = static_cast<uint8_t>(bit_len >> (56 - i * 8));
+        }
+        process_block(buffer);
+    }
+
+    // ֽ
+    uint64_t length() const {
+        return total_len;
+    }
+
+    // գfinalize֮ǰãָupdateδжϵĽͬ
+    void snapshot(SM3Snapshot& out) const {
+        memset(out.bytes, 0, SM3Snapshot::SIZE);
+        memcpy(out.bytes, "SM3C", 4);
+        out.bytes[4] = SM3Snapshot::VERSION;
+        for (int i = 0; i < 8; i++) {
+            out.bytes[8 + i] = static_cast<uint8_t>(total_len >> (56 - i * 8));
+        }
+        for (int i = 0; i < 8; i++) {
+            out.bytes[16 + i * 4] = static_cast<uint8_t>(state[i] >> 24);
+            out.bytes[16 + i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            out.bytes[16 + i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            out.bytes[16 + i * 4 + 3] = static_cast<uint8_t>(state[i]);
+        }
+        memcpy(out.bytes + 48, buffer, static_cast<size_t>(total_len % 64));
+    }
+
+    // ӿջָʶ汾ֽڲϷʱfalseԭ״̬
+    bool restore(const SM3Snapshot& in) {
+        if (memcmp(in.bytes, "SM3C", 4) != 0 || in.bytes[4] != SM3Snapshot::VERSION
+            || in.bytes[5] != 0 || in.bytes[6] != 0 || in.bytes[7] != 0) {
+            return false;
+        }
+        uint64_t len = 0;
+        for (int i = 0; i < 8; i++) {
+            len = (len << 8) | in.bytes[8 + i];
+        }
+        for (size_t i = 48 + static_cast<size_t>(len % 64); i < SM3Snapshot::SIZE; i++) {
+            if (in.bytes[i] != 0) {
+                return false;
+            }
+        }
+        total_len = len;
+        for (int i = 0; i < 8; i++) {
+            state[i] = (static_cast<uint32_t>(in.bytes[16 + i * 4]) << 24)
+                | (static_cast<uint32_t>(in.bytes[16 + i * 4 + 1]) << 16)
+                | (static_cast<uint32_t>(in.bytes[16 + i * 4 + 2]) << 8)
+                | static_cast<uint32_t>(in.bytes[16 + i * 4 + 3]);
+        }
+        memcpy(buffer, in.bytes + 48, 64);
+        return true;
+    }
+
+    // 32ֽڶժҪfinalize֮ã
+    void digest(uint8_t out[32]) const {
+        for (int i = 0; i < 8; ++i) {
+            out[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+            out[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            out[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            out[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+        }
+    }
+
+    // ʮժҪ
+    string digest() const {
+        uint8_t out[32];
+        digest(out);
+        return toHex(out);
+    }
+
+    // һԼlenֽݵĶժҪ
+    static void hash(const uint8_t* data, size_t len, uint8_t out[32]) {
+        SM3 sm3;
+        sm3.update(data, len);
+        sm3.finalize();
+        sm3.digest(out);
+    }
+
+    // ժҪתΪ64Сдʮַ
+    static string toHex(const uint8_t digest[32]) {
+        static const char digits[] = "0123456789abcdef";
+        char text[64];
+        for (int i = 0; i < 32; ++i) {
+            text[i * 2] = digits[digest[i] >> 4];
+            text[i * 2 + 1] = digits[digest[i] & 0x0F];
+        }
+        return string(text, 64);
+    }
+
+private:
+    void process_block(const uint8_t* block) {
+        SM3_TRACE(Compress, sm3Compress().impl, 64);
+        sm3Compress().compress(state, block, 1);
     }
 
     uint32_t state[8];
     uint64_t total_len;
-    vector<uint8_t> buffer;
+    uint8_t buffer[64];     // δһݣΪtotal_len % 64
 };
 
+static_assert(is_trivially_copyable<SM3>::value, "SM3Ӧɰֵ");
+static_assert(is_trivially_copyable<SM3Snapshot>::value && sizeof(SM3Snapshot) == SM3Snapshot::SIZE,
+    "ӦΪPOD");
+
 string sm3_hash(const string& input) {
     SM3 sm3;
     sm3.update(reinterpret_cast<const uint8_t*>(input.data()), input.size());
@@ -186,19 +910,1812 @@ string sm3_hash(const string& input) {
     return sm3.digest();
 }
 
-// test
-int main() {
+// ==================== ໺SM3 ====================
+// ĶϢɢС¼УͣʱϢѹ޷
+// SIMDȡÿSIMDͨһϢҵȡϢ
+// ͨÿͨѹԼһ飻ĳ·Ϣȫ飨ͨɵ
+// 飩꼴дժҪһϢ˳̲һϢҲܱͨ
 
-    cout << "SM3(\"abc\") = " << sm3_hash("abc") << endl;
-    cout << "SM3(\"abcdabcdabcdabcdabcdabcdabcd\") = "<< sm3_hash("abcdabcdabcdabcdabcdabcdabcd") << endl;
+// һɢеϢdigestΪ32ֽڶժҪλ
+struct SM3Job {
+    const uint8_t* data;
+    size_t len;
+    uint8_t* digest;
+};
 
-    string long_str(1024 * 1024, 'a');
-    clock_t start = clock();
-    string hash = sm3_hash(long_str);
-    clock_t end = clock();
-    cout << "Time for 1MB data: "
-        << (double)(end - start) / CLOCKS_PER_SEC * 1000
-        << " ms" << endl;
+class SM3MultiBuffer {
+public:
+    SM3MultiBuffer() : kernels(sm3LaneKernels(sm3BestLaneImpl())) {}
+
+    // ָʵ֣CPU֧ʱfalseԭã
+    bool setImpl(SM3Impl impl) {
+        if (!sm3ImplSupported(impl)) {
+            return false;
+        }
+        kernels = sm3LaneKernels(impl);
+        return true;
+    }
+
+    SM3Impl impl() const {
+        return kernels->impl;
+    }
+
+    const char* implName() const {
+        return kernels->name;
+    }
+
+    // ͬʱϢ
+    unsigned lanes() const {
+        return kernels->lanes;
+    }
+
+    // countϢժҪʹSM3ͬҵ˳Ӱ
+    void hash(const SM3Job* jobs, size_t count) const {
+        hash(jobs, count, SM3_IV, 0);
+    }
+
+    // Ϣͬһѹǰ׺֮chainΪprefixLenֽڣ64ıֵ
+    // ժҪΪSM3(ǰ׺ || Ϣ)HMACȹ̶ǰ׺ĳǰ׺ֻѹһ
+    void hash(const SM3Job* jobs, size_t count, const uint32_t chain[8], uint64_t prefixLen) const {
+        SM3_TRACE(MultiBuffer, kernels->impl, jobBytes(jobs, count));
+        if (kernels->lanes == 1) {
+            for (size_t i = 0; i < count; i++) {
+                Lane lane;
+                uint32_t st[8];
+                lane.start(jobs[i], prefixLen);
+                memcpy(st, chain, sizeof(st));
+                lane.finishScalar(st);
+            }
+            return;
+        }
+
+        const unsigned N = kernels->lanes;
+        alignas(64) uint32_t st[8 * MAX_LANES];
+        Lane lanes[MAX_LANES];
+        const uint8_t* blocks[MAX_LANES];
+        static const uint8_t idleBlock[64] = { 0 };
+        size_t next = 0;
+        unsigned active = 0;
+        for (;;) {
+            // ͨϢ
+            for (unsigned l = 0; l < N && next < count; l++) {
+                if (lanes[l].job == nullptr) {
+                    lanes[l].start(jobs[next++], prefixLen);
+                    for (int k = 0; k < 8; k++) {
+                        st[k * N + l] = chain[k];
+                    }
+                    active++;
+                }
+            }
+            if (active == 0) {
+                break;
+            }
+
+            // ѿֻʣͨڹʱһSIMDѹĴ۳·
+            if (next == count && active <= N / 8) {
+                for (unsigned l = 0; l < N; l++) {
+                    if (lanes[l].job != nullptr) {
+                        uint32_t lane[8];
+                        for (int k = 0; k < 8; k++) {
+                            lane[k] = st[k * N + l];
+                        }
+                        lanes[l].finishScalar(lane);
+                    }
+                }
+                break;
+            }
+
+            for (unsigned l = 0; l < N; l++) {
+                blocks[l] = lanes[l].job != nullptr ? lanes[l].current() : idleBlock;
+            }
+            kernels->compressLanes(st, blocks);
+            for (unsigned l = 0; l < N; l++) {
+                if (lanes[l].job != nullptr && lanes[l].advance()) {
+                    for (int k = 0; k < 8; k++) {
+                        storeBE32(lanes[l].job->digest + k * 4, st[k * N + l]);
+                    }
+                    lanes[l].job = nullptr;
+                    active--;
+                }
+            }
+        }
+    }
+
+private:
+    static const unsigned MAX_LANES = 16;
+
+    // һͨڴϢϢе飬Ȼ12
+    struct Lane {
+        const SM3Job* job = nullptr;
+        const uint8_t* data;
+        size_t fullBlocks;
+        unsigned padBlocks;
+        unsigned padDone;
+        uint8_t pad[128];
+
+        void start(const SM3Job& j, uint64_t prefixLen) {
+            job = &j;
+            data = j.data;
+            fullBlocks = j.len / 64;
+            size_t tail = j.len % 64;
+            padBlocks = tail < 56 ? 1 : 2;
+            padDone = 0;
+            if (tail > 0) {
+                memcpy(pad, j.data + fullBlocks * 64, tail);
+            }
+            pad[tail] = 0x80;
+            memset(pad + tail + 1, 0, padBlocks * 64 - tail - 1);
+            uint64_t bits = (prefixLen + j.len) * 8;
+            storeBE32(pad + padBlocks * 64 - 8, static_cast<uint32_t>(bits >> 32));
+            storeBE32(pad + padBlocks * 64 - 4, static_cast<uint32_t>(bits));
+        }
+
+        const uint8_t* current() const {
+            return fullBlocks > 0 ? data : pad + padDone * 64;
+        }
+
+        // ǰһ飬ϢǷѴ
+        bool advance() {
+            if (fullBlocks > 0) {
+                data += 64;
+                fullBlocks--;
+                return false;
+            }
+            return ++padDone == padBlocks;
+        }
+
+        // õ·ѹʣ鲢дժҪ
+        void finishScalar(uint32_t st[8]) {
+            sm3Compress().compress(st, data, fullBlocks);
+            sm3Compress().compress(st, pad + padDone * 64, padBlocks - padDone);
+            for (int k = 0; k < 8; k++) {
+                storeBE32(job->digest + k * 4, st[k]);
+            }
+            job = nullptr;
+        }
+    };
+
+
+    static size_t jobBytes(const SM3Job* jobs, size_t count) {
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += jobs[i].len;
+        }
+        return total;
+    }
+
+    const SM3LaneKernels* kernels;
+};
+
+// ==================== HMAC-SM3GB/T 15852.2 / RFC 2104 ====================
+// HMAC(K, m) = SM3((K  opad) || SM3((K  ipad) || m))K  ipadK  opadռһ飬
+// ʱѹһβֵ֮ÿϢֻѹķ飨䣩һ飬
+// ÿδͷSM3ѹ
+class SM3HMAC {
+public:
+    // 64ֽڵԿȡSM3ժҪ
+    SM3HMAC(const uint8_t* key, size_t keyLen) {
+        uint8_t k[64] = { 0 };
+        if (keyLen > 64) {
+            SM3::hash(key, keyLen, k);
+        }
+        else if (keyLen > 0) {
+            memcpy(k, key, keyLen);
+        }
+        uint8_t block[64];
+        for (int i = 0; i < 64; i++) {
+            block[i] = k[i] ^ 0x36;
+        }
+        memcpy(inner, SM3_IV, sizeof(inner));
+        sm3Compress().compress(inner, block, 1);
+        for (int i = 0; i < 64; i++) {
+            block[i] = k[i] ^ 0x5C;
+        }
+        memcpy(outer, SM3_IV, sizeof(outer));
+        sm3Compress().compress(outer, block, 1);
+    }
+
+    // lenֽϢ32ֽMAC
+    void mac(const uint8_t* msg, size_t len, uint8_t out[32]) const {
+        uint8_t innerDigest[32];
+        SM3 innerCtx(inner, 64);
+        innerCtx.update(msg, len);
+        innerCtx.finalize();
+        innerCtx.digest(innerDigest);
+        SM3 outerCtx(outer, 64);
+        outerCtx.update(innerDigest, 32);
+        outerCtx.finalize();
+        outerCtx.digest(out);
+    }
+
+    // УMACȽʱ벻ƥλ޹أ
+    bool verify(const uint8_t* msg, size_t len, const uint8_t tag[32]) const {
+        uint8_t expect[32];
+        mac(msg, len, expect);
+        uint8_t diff = 0;
+        for (int i = 0; i < 32; i++) {
+            diff |= expect[i] ^ tag[i];
+        }
+        return diff == 0;
+    }
+
+    // ͬһԿ㣺jobs[i].digestõiϢMAC
+    // ڲ㶼߶໺壺ȴڲֵϢڲժҪ
+    // ٰЩժҪΪ32ֽϢֵ㣨ԭظǣimpl֧ʱĬʵ
+    void macMany(const SM3Job* jobs, size_t count, SM3Impl impl = sm3BestLaneImpl()) const {
+        SM3MultiBuffer mb;
+        mb.setImpl(impl);
+        const size_t CHUNK = 256;
+        SM3Job outerJobs[CHUNK];
+        for (size_t first = 0; first < count; first += CHUNK) {
+            size_t n = min(CHUNK, count - first);
+            mb.hash(jobs + first, n, inner, 64);
+            for (size_t i = 0; i < n; i++) {
+                outerJobs[i] = { jobs[first + i].digest, 32, jobs[first + i].digest };
+            }
+            mb.hash(outerJobs, n, outer, 64);
+        }
+    }
+
+private:
+    friend class SM3PBKDF2;
+
+    uint32_t inner[8];  // ѹK  ipadֵ֮
+    uint32_t outer[8];  // ѹK  opadֵ֮
+};
+
+// ϣʹõĳפ̳߳أڹ״ʹʱ
+// ̴ͬ߳ӹȡ񼴿
+class SM3ThreadPool {
+public:
+    static SM3ThreadPool& instance() {
+        static SM3ThreadPool pool;
+        return pool;
+    }
+
+    // ִbody(0) .. body(numTasks - 1)threads̲߳루̣߳ʱȫ
+    // ͬ߳ͬʱʱִ
+    template <typename F>
+    void run(size_t numTasks, unsigned threads, const F& body) {
+        lock_guard<mutex> serial(runMutex);
+        threads = static_cast<unsigned>(min<size_t>(threads, numTasks));
+        if (threads <= 1) {
+            for (size_t i = 0; i < numTasks; i++) {
+                body(i);
+            }
+            return;
+        }
+        {
+            unique_lock<mutex> lock(m);
+            while (workers.size() + 1 < threads) {
+                unsigned id = static_cast<unsigned>(workers.size() + 1);
+                workers.emplace_back(&SM3ThreadPool::workerMain, this, id);
+            }
+            invoke = [](const void* f, size_t i) { (*static_cast<const F*>(f))(i); };
+            context = &body;
+            taskCount = numTasks;
+            nextTask.store(0, memory_order_relaxed);
+            jobThreads = threads;
+            active = threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        work();
+
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [this] { return active == 0; });
+    }
+
+    ~SM3ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_all();
+        for (thread& t : workers) {
+            t.join();
+        }
+    }
+
+private:
+    SM3ThreadPool() {}
+
+    void work() {
+        for (;;) {
+            size_t task = nextTask.fetch_add(1, memory_order_relaxed);
+            if (task >= taskCount) {
+                return;
+            }
+            invoke(context, task);
+        }
+    }
+
+    void workerMain(unsigned id) {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [&] { return stop || (generation != seen && id < jobThreads); });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+            }
+            work();
+            {
+                lock_guard<mutex> lock(m);
+                active--;
+            }
+            done.notify_one();
+        }
+    }
+
+    mutex runMutex;
+    mutex m;
+    condition_variable wake;
+    condition_variable done;
+    vector<thread> workers;
+    void (*invoke)(const void*, size_t) = nullptr;
+    const void* context = nullptr;
+    size_t taskCount = 0;
+    atomic<size_t> nextTask{ 0 };
+    unsigned jobThreads = 0;
+    unsigned active = 0;
+    unsigned long long generation = 0;
+    bool stop = false;
+};
+
+// ==================== ϣSM3-Tree ====================
+// SM3ǴеMDṹļֻܵ˼㡣ģʽгɶҶӣ
+// Ҷ֮以̳߳زУÿö໺SIMDͬʱһҶӡ
+// ͨSM3ͬһժҪ˫Լʹá
+//
+// 汾1
+//   - ݰleafSizeзΪҶӣĬ1 MiBΪ64ıΧ4 KiB..1 GiB
+//     һҶӿԲΪһҶ
+//   - Ҷӽڵ = SM3(Ҷ)
+//   - ڲڵ = SM3(0x01 || ӽڵ || ӽڵ)ÿϲ
+//     䵥ҽڵԭһ㣬ֱֻʣһڵ
+//   - ժҪ = SM3(0x02 || 汾(1ֽ) || leafSize(8ֽڴ) || ܳ(8ֽڴ) || ڵ)
+//     ״ȫleafSizeܳȾ߶ժҪ
+class SM3Tree {
+public:
+    static const uint8_t VERSION = 1;
+    static const size_t DEFAULT_LEAF_SIZE = 1 << 20;
+    static const size_t MAX_BATCH_BYTES = static_cast<size_t>(32) << 20;  // 
+
+    // threadsΪ߳0Ϊȫ߼
+    explicit SM3Tree(unsigned threads = 0) : leafSize(DEFAULT_LEAF_SIZE), totalLen(0), leafCount(0), leafFill(0) {
+        setThreads(threads);
+    }
+
+    // ҶӴСֻκ֮ǰãϷʱfalseԭ
+    bool setLeafSize(size_t size) {
+        if (totalLen != 0 || size % 64 != 0 || size < (4 << 10) || size > (static_cast<size_t>(1) << 30)) {
+            return false;
+        }
+        leafSize = size;
+        return true;
+    }
+
+    void setThreads(unsigned n) {
+        threads = n != 0 ? n : max(1u, thread::hardware_concurrency());
+    }
+
+    // ÿõһҶժҪʱҶ˳ãڱҶժҪԱպֻУ鲿ݣ
+    void setLeafCallback(function<void(uint64_t index, const uint8_t digest[32])> callback) {
+        onLeaf = move(callback);
+    }
+
+    // ʽ룺ݵＴзҶӣܹһм㣬Ҫ֪ܳ
+    void update(const uint8_t* data, size_t len) {
+        totalLen += len;
+        const size_t batchBytes = batchLeaves() * leafSize;
+        if (batchBytes == 0) {
+            streamLeaves(data, len);
+            return;
+        }
+        while (len > 0) {
+            // Ϊ㹻һʱֱڵߵڴϼȫҶ
+            if (pending.empty() && len >= batchBytes) {
+                size_t bytes = len / leafSize * leafSize;
+                hashLeaves(data, bytes);
+                data += bytes;
+                len -= bytes;
+                continue;
+            }
+            if (pending.capacity() < batchBytes) {
+                pending.reserve(batchBytes);
+            }
+            size_t n = min(len, batchBytes - pending.size());
+            pending.insert(pending.end(), data, data + n);
+            data += n;
+            len -= n;
+            if (pending.size() == batchBytes) {
+                hashLeaves(pending.data(), pending.size());
+                pending.clear();
+            }
+        }
+    }
+
+    // ʣݲ32ֽڸժҪ֮resetܼµ
+    void finalize(uint8_t out[32]) {
+        if (leafFill > 0) {
+            finishStreamLeaf();
+        }
+        else if (!pending.empty() || leafCount == 0) {
+            hashLeaves(pending.data(), pending.size());
+            pending.clear();
+        }
+
+        // ջиĽڵϲ
+        uint8_t top[32];
+        memcpy(top, stack.back().digest, 32);
+        for (size_t i = stack.size() - 1; i-- > 0;) {
+            combine(stack[i].digest, top, top);
+        }
+
+        uint8_t header[1 + 1 + 8 + 8];
+        header[0] = 0x02;
+        header[1] = VERSION;
+        for (int i = 0; i < 8; i++) {
+            header[2 + i] = static_cast<uint8_t>(static_cast<uint64_t>(leafSize) >> (56 - i * 8));
+            header[10 + i] = static_cast<uint8_t>(totalLen >> (56 - i * 8));
+        }
+        SM3 root;
+        root.update(header, sizeof(header));
+        root.update(top, 32);
+        root.finalize();
+        root.digest(out);
+    }
+
+    void reset() {
+        totalLen = 0;
+        leafCount = 0;
+        leafFill = 0;
+        leafCtx.reset();
+        pending.clear();
+        stack.clear();
+    }
+
+    // һԼ㣻leafSizeϷʱfalseժҪ
+    static bool hash(const uint8_t* data, size_t len, uint8_t out[32], unsigned threads = 0,
+        size_t leafSize = DEFAULT_LEAF_SIZE) {
+        SM3Tree tree(threads);
+        if (!tree.setLeafSize(leafSize)) {
+            return false;
+        }
+        tree.update(data, len);
+        tree.finalize(out);
+        return true;
+    }
+
+private:
+    // ջеĽڵ㣺levelһӦ2^levelҶ
+    struct Node {
+        unsigned level;
+        uint8_t digest[32];
+    };
+
+    // ÿҶ㹻̵߳ͨͬʱMAX_BATCH_BYTES
+    // Ϊ0ʱҶѳޣٻ壬ΪҶʽ
+    size_t batchLeaves() const {
+        size_t lanes = SM3MultiBuffer().lanes();
+        size_t wanted = static_cast<size_t>(threads) * lanes;
+        return min(wanted, MAX_BATCH_BYTES / leafSize);
+    }
+
+    // Ҷӣֱӽ뵱ǰҶӵSM3ģǰҶΪ뺬Ҷʱ
+    // ЩҶڵߵڴϲм
+    void streamLeaves(const uint8_t* data, size_t len) {
+        while (len > 0) {
+            if (leafFill == 0 && len >= leafSize) {
+                size_t bytes = len / leafSize * leafSize;
+                hashLeaves(data, bytes);
+                data += bytes;
+                len -= bytes;
+                continue;
+            }
+            size_t n = min(len, leafSize - leafFill);
+            leafCtx.update(data, n);
+            leafFill += n;
+            data += n;
+            len -= n;
+            if (leafFill == leafSize) {
+                finishStreamLeaf();
+            }
+        }
+    }
+
+    void finishStreamLeaf() {
+        uint8_t digest[32];
+        leafCtx.finalize();
+        leafCtx.digest(digest);
+        leafCtx.reset();
+        leafFill = 0;
+        addLeaf(digest);
+    }
+
+    // ڲڵ = SM3(0x01 || left || right)outص
+    static void combine(const uint8_t left[32], const uint8_t right[32], uint8_t out[32]) {
+        uint8_t node[65];
+        node[0] = 0x01;
+        memcpy(node + 1, left, 32);
+        memcpy(node + 33, right, 32);
+        SM3::hash(node, sizeof(node), out);
+    }
+
+    // мbytesֽڵҶӣֻһԲ˳
+    void hashLeaves(const uint8_t* data, size_t bytes) {
+        size_t count = bytes == 0 ? 1 : (bytes + leafSize - 1) / leafSize;
+        vector<uint8_t> digests(count * 32);
+        vector<SM3Job> jobs(count);
+        for (size_t i = 0; i < count; i++) {
+            size_t offset = i * leafSize;
+            jobs[i] = { data + offset, min(leafSize, bytes - offset), digests.data() + i * 32 };
+        }
+
+        SM3MultiBuffer mb;
+        size_t lanes = mb.lanes();
+        size_t tasks = (count + lanes - 1) / lanes;
+        SM3ThreadPool::instance().run(tasks, threads, [&](size_t t) {
+            size_t first = t * lanes;
+            mb.hash(jobs.data() + first, min(lanes, count - first));
+        });
+
+        for (size_t i = 0; i < count; i++) {
+            addLeaf(digests.data() + i * 32);
+        }
+    }
+
+    void addLeaf(const uint8_t digest[32]) {
+        if (onLeaf) {
+            onLeaf(leafCount, digest);
+        }
+        push(digest);
+        leafCount++;
+    }
+
+    // һҶӣջͬĽڵϲƶƼĽλ
+    void push(const uint8_t leaf[32]) {
+        Node node;
+        node.level = 0;
+        memcpy(node.digest, leaf, 32);
+        while (!stack.empty() && stack.back().level == node.level) {
+            combine(stack.back().digest, node.digest, node.digest);
+            node.level++;
+            stack.pop_back();
+        }
+        stack.push_back(node);
+    }
+
+    size_t leafSize;
+    unsigned threads;
+    uint64_t totalLen;
+    uint64_t leafCount;
+    vector<uint8_t> pending;    // δܹһ
+    SM3 leafCtx;                // ҶʱڼҶ
+    size_t leafFill;
+    vector<Node> stack;         // δϲջջݼ
+    function<void(uint64_t, const uint8_t*)> onLeaf;
+};
+
+// ==================== ԿGB/T 32918.3 KDF ====================
+// K = SM3(Z || ct=1) || SM3(Z || ct=2) || ...ȡǰklenֽڣctΪ32λ˼
+// 黥ZڹʱѹһΣ֮ÿֻʣZβ
+// ɵ1~2飬໺8/16·ͬʱ㣻ܳʱָٰ̳߳
+class SM3KDF {
+public:
+    // Ϊ32λ(2^32 - 1)ժҪ
+    static const uint64_t MAX_OUTPUT = 0xFFFFFFFFull * 32;
+
+    SM3KDF(const uint8_t* z, size_t zLen) : prefixLen(zLen / 64 * 64), tailLen(zLen % 64), threads(1) {
+        memcpy(chain, SM3_IV, sizeof(chain));
+        sm3Compress().compress(chain, z, zLen / 64);
+        if (tailLen > 0) {
+            memcpy(tail, z + prefixLen, tailLen);
+        }
+    }
+
+    // ָ໺ʵ֣CPU֧ʱfalseԭã
+    bool setImpl(SM3Impl impl) {
+        return mb.setImpl(impl);
+    }
+
+    // ߳Ĭ1SM2ӽܵĶϢֵû̳߳أ0Ϊȫ߼
+    void setThreads(unsigned n) {
+        threads = n != 0 ? n : max(1u, thread::hardware_concurrency());
+    }
+
+    // lenֽдoutlenMAX_OUTPUTʱfalseout
+    bool derive(uint8_t* out, size_t len) const {
+        if (static_cast<uint64_t>(len) > MAX_OUTPUT) {
+            return false;
+        }
+        size_t counters = (len + 31) / 32;
+        size_t tasks = (counters + CHUNK - 1) / CHUNK;
+        if (threads <= 1 || tasks <= 1) {
+            for (size_t t = 0; t < tasks; t++) {
+                deriveChunk(out, len, t * CHUNK, min(CHUNK, counters - t * CHUNK));
+            }
+        }
+        else {
+            SM3ThreadPool::instance().run(tasks, threads, [&](size_t t) {
+                deriveChunk(out, len, t * CHUNK, min(CHUNK, counters - t * CHUNK));
+            });
+        }
+        return true;
+    }
+
+    // һԼ
+    static bool derive(const uint8_t* z, size_t zLen, uint8_t* out, size_t len) {
+        return SM3KDF(z, zLen).derive(out, len);
+    }
+
+private:
+    static constexpr size_t CHUNK = 256;  // ÿļ
+
+    // first+1 .. first+n飻Ŀֱдoutضϵһ龭ʱ
+    void deriveChunk(uint8_t* out, size_t len, size_t first, size_t n) const {
+        const size_t msgLen = tailLen + 4;
+        uint8_t msgs[CHUNK * 67];
+        SM3Job jobs[CHUNK];
+        uint8_t last[32];
+        for (size_t i = 0; i < n; i++) {
+            uint8_t* m = msgs + i * msgLen;
+            if (tailLen > 0) {
+                memcpy(m, tail, tailLen);
+            }
+            storeBE32(m + tailLen, static_cast<uint32_t>(first + i + 1));
+            size_t offset = (first + i) * 32;
+            jobs[i] = { m, msgLen, offset + 32 <= len ? out + offset : last };
+        }
+        mb.hash(jobs, n, chain, prefixLen);
+        size_t end = (first + n) * 32;
+        if (end > len) {
+            memcpy(out + end - 32, last, len - (end - 32));
+        }
+    }
+
+    uint32_t chain[8];      // ѹZֵ֮
+    uint64_t prefixLen;
+    size_t tailLen;
+    uint8_t tail[64];       // Zвһβ
+    unsigned threads;
+    SM3MultiBuffer mb;
+};
+
+// ==================== PBKDF2-HMAC-SM3RFC 8018 ====================
+// DK = T1 || T2 || ...Ti = U1  U2  ...  UcU1 = HMAC(P, S || INT(i))Uj = HMAC(P, Uj-1)
+// ÿε̶εѹڲ㣺K  ipad֮32ֽڵUj-1㣺K  opad֮
+// ڲժҪͬһTiĵ֮ȫСӿÿSIMDͨһ(, )
+// ͨԼֵͬʱѹͬҵɺ󼴻һ
+struct SM3PBKDF2Job {
+    const uint8_t* password;
+    size_t passwordLen;
+    const uint8_t* salt;
+    size_t saltLen;
+    uint32_t iterations;    // Ϊ1
+    uint8_t* out;           // outLenֽڵԿ
+    size_t outLen;
+};
+
+class SM3PBKDF2 {
+public:
+    // Ϊ32λԿ(2^32 - 1)ժҪ
+    static const uint64_t MAX_OUTPUT = 0xFFFFFFFFull * 32;
+
+    SM3PBKDF2() : kernels(sm3LaneKernels(sm3BestLaneImpl())) {}
+
+    // ָʵ֣CPU֧ʱfalseԭã
+    bool setImpl(SM3Impl impl) {
+        if (!sm3ImplSupported(impl)) {
+            return false;
+        }
+        kernels = sm3LaneKernels(impl);
+        return true;
+    }
+
+    const char* implName() const {
+        return kernels->name;
+    }
+
+    // deriveͬҵĵΪ0ʱfalseκμ
+    bool deriveMany(const SM3PBKDF2Job* jobs, size_t count) const {
+        size_t outBytes = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (jobs[i].iterations == 0 || static_cast<uint64_t>(jobs[i].outLen) > MAX_OUTPUT) {
+                return false;
+            }
+            outBytes += jobs[i].outLen;
+        }
+        SM3_TRACE(MultiBuffer, kernels->impl, outBytes);
+
+        // ҵ˳ȡ(ҵ, )ͬһҵĸȡ
+        // HMACֵȡ1ʱһΣ֮
+        size_t nextJob = 0;
+        uint32_t nextBlock = 1;
+        uint32_t jobInner[8], jobOuter[8];
+        auto fill = [&](Lane& lane) {
+            while (nextJob < count) {
+                const SM3PBKDF2Job& job = jobs[nextJob];
+                if (static_cast<uint64_t>(nextBlock - 1) * 32 >= job.outLen) {
+                    nextJob++;
+                    nextBlock = 1;
+                    continue;
+                }
+                if (nextBlock == 1) {
+                    SM3HMAC hmac(job.password, job.passwordLen);
+                    memcpy(jobInner, hmac.inner, sizeof(jobInner));
+                    memcpy(jobOuter, hmac.outer, sizeof(jobOuter));
+                }
+                if (lane.start(job, nextBlock++, jobInner, jobOuter)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if (kernels->lanes == 1) {
+            Lane lane;
+            while (fill(lane)) {
+                lane.finishScalar();
+            }
+            return true;
+        }
+
+        const unsigned N = kernels->lanes;
+        alignas(64) uint32_t innerT[8 * MAX_LANES];   // ֵͨתã
+        alignas(64) uint32_t outerT[8 * MAX_LANES];
+        alignas(64) uint32_t st[8 * MAX_LANES];
+        Lane lanes[MAX_LANES];
+        const uint8_t* blocks[MAX_LANES];
+        static const uint8_t idleBlock[64] = { 0 };
+        unsigned active = 0;
+        bool more = true;
+        for (;;) {
+            for (unsigned l = 0; l < N && more; l++) {
+                if (lanes[l].job == nullptr) {
+                    more = fill(lanes[l]);
+                    if (more) {
+                        for (int k = 0; k < 8; k++) {
+                            innerT[k * N + l] = lanes[l].inner[k];
+                            outerT[k * N + l] = lanes[l].outer[k];
+                        }
+                        active++;
+                    }
+                }
+            }
+            if (active == 0) {
+                break;
+            }
+
+            // ໺ɢֻͬʣͨʱ·õ·ѹ
+            if (!more && active <= N / 8) {
+                for (unsigned l = 0; l < N; l++) {
+                    if (lanes[l].job != nullptr) {
+                        lanes[l].finishScalar();
+                    }
+                }
+                break;
+            }
+
+            // ڲ㣺K  ipad֮Uj-1
+            memcpy(st, innerT, sizeof(uint32_t) * 8 * N);
+            for (unsigned l = 0; l < N; l++) {
+                blocks[l] = lanes[l].job != nullptr ? lanes[l].u : idleBlock;
+            }
+            kernels->compressLanes(st, blocks);
+            for (unsigned l = 0; l < N; l++) {
+                if (lanes[l].job != nullptr) {
+                    for (int k = 0; k < 8; k++) {
+                        storeBE32(lanes[l].h + k * 4, st[k * N + l]);
+                    }
+                    blocks[l] = lanes[l].h;
+                }
+            }
+
+            // 㣺K  opad֮ڲժҪõUj
+            memcpy(st, outerT, sizeof(uint32_t) * 8 * N);
+            kernels->compressLanes(st, blocks);
+            for (unsigned l = 0; l < N; l++) {
+                if (lanes[l].job == nullptr) {
+                    continue;
+                }
+                uint32_t u[8];
+                for (int k = 0; k < 8; k++) {
+                    u[k] = st[k * N + l];
+                }
+                if (lanes[l].absorb(u)) {
+                    active--;
+                }
+            }
+        }
+        return true;
+    }
+
+    // ʹõ·ѹ
+    static bool derive(const uint8_t* password, size_t passwordLen, const uint8_t* salt, size_t saltLen,
+        uint32_t iterations, uint8_t* out, size_t outLen) {
+        SM3PBKDF2Job job = { password, passwordLen, salt, saltLen, iterations, out, outLen };
+        SM3PBKDF2 pbkdf2;
+        pbkdf2.setImpl(SM3Impl::Scalar);
+        return pbkdf2.deriveMany(&job, 1);
+    }
+
+    // УȽʱ벻ƥλ޹أlenΪ0ʱʲôҲûбȽϣһɷfalse
+    static bool verify(const uint8_t* password, size_t passwordLen, const uint8_t* salt, size_t saltLen,
+        uint32_t iterations, const uint8_t* expect, size_t len) {
+        if (len == 0) {
+            return false;
+        }
+        vector<uint8_t> actual(len);
+        if (!derive(password, passwordLen, salt, saltLen, iterations, actual.data(), len)) {
+            return false;
+        }
+        uint8_t diff = 0;
+        for (size_t i = 0; i < len; i++) {
+            diff |= actual[i] ^ expect[i];
+        }
+        return diff == 0;
+    }
+
+private:
+    static const unsigned MAX_LANES = 16;
+
+    // һͨڼTi
+    struct Lane {
+        const SM3PBKDF2Job* job = nullptr;
+        uint32_t block;
+        uint32_t remaining;     // ĵ
+        uint32_t inner[8];
+        uint32_t outer[8];
+        uint8_t u[64];          // Uj-1䣨ǰ滹K  ipadһ飬96ֽڣ
+        uint8_t h[64];          // ڲժҪ
+        uint8_t t[32];          // U1  ...  Uj
+
+        // ӿHMACֵU1ֻһεʱֱдfalseͨԿУ
+        bool start(const SM3PBKDF2Job& j, uint32_t index, const uint32_t innerChain[8], const uint32_t outerChain[8]) {
+            memcpy(inner, innerChain, sizeof(inner));
+            memcpy(outer, outerChain, sizeof(outer));
+            uint8_t be[4];
+            storeBE32(be, index);
+            SM3 innerCtx(inner, 64);
+            innerCtx.update(j.salt, j.saltLen);
+            innerCtx.update(be, 4);
+            innerCtx.finalize();
+            innerCtx.digest(h);
+            SM3 outerCtx(outer, 64);
+            outerCtx.update(h, 32);
+            outerCtx.finalize();
+            outerCtx.digest(t);
+
+            job = &j;
+            block = index;
+            remaining = j.iterations - 1;
+            if (remaining == 0) {
+                finish();
+                return false;
+            }
+            memcpy(u, t, 32);
+            padDigest(u);
+            padDigest(h);
+            return true;
+        }
+
+        // һεĽUjֵʽTiǷ
+        bool absorb(const uint32_t st[8]) {
+            for (int k = 0; k < 8; k++) {
+                storeBE32(u + k * 4, st[k]);
+            }
+            for (int i = 0; i < 32; i++) {
+                t[i] ^= u[i];
+            }
+            if (--remaining == 0) {
+                finish();
+                return true;
+            }
+            return false;
+        }
+
+        // õ·ѹʣ
+        void finishScalar() {
+            const SM3Kernels& k = sm3Compress();
+            while (job != nullptr) {
+                uint32_t st[8];
+                memcpy(st, inner, sizeof(st));
+                k.compress(st, u, 1);
+                for (int i = 0; i < 8; i++) {
+                    storeBE32(h + i * 4, st[i]);
+                }
+                memcpy(st, outer, sizeof(st));
+                k.compress(st, h, 1);
+                absorb(st);
+            }
+        }
+
+        // дTiһضϣ
+        void finish() {
+            size_t offset = static_cast<size_t>(block - 1) * 32;
+            memcpy(job->out + offset, t, min(static_cast<size_t>(32), job->outLen - offset));
+            job = nullptr;
+        }
+
+        // 32ֽժҪΪڶϢʱ䣺0x80㣬ܳ96ֽ = 768λ
+        static void padDigest(uint8_t b[64]) {
+            b[32] = 0x80;
+            memset(b + 33, 0, 29);
+            b[62] = 0x03;
+            b[63] = 0x00;
+        }
+    };
+
+    const SM3LaneKernels* kernels;
+};
+
+// ==================== Լ죨selftest ====================
+// ׼GB/T 32905¼Aֲԣǰɵѹʵݡ
+// ±ȽϣзֵĶupdateһԼĽȽ
+
+// ϣУΪSM3TreeĶ
+static void treeHashReference(const uint8_t* data, size_t len, size_t leafSize, uint8_t out[32]) {
+    vector<array<uint8_t, 32>> level;
+    for (size_t offset = 0; offset < len || level.empty(); offset += leafSize) {
+        array<uint8_t, 32> leaf;
+        SM3::hash(data + offset, min(leafSize, len - offset), leaf.data());
+        level.push_back(leaf);
+    }
+    while (level.size() > 1) {
+        vector<array<uint8_t, 32>> upper;
+        for (size_t i = 0; i + 1 < level.size(); i += 2) {
+            uint8_t node[65];
+            node[0] = 0x01;
+            memcpy(node + 1, level[i].data(), 32);
+            memcpy(node + 33, level[i + 1].data(), 32);
+            array<uint8_t, 32> parent;
+            SM3::hash(node, sizeof(node), parent.data());
+            upper.push_back(parent);
+        }
+        if (level.size() % 2 == 1) {
+            upper.push_back(level.back());
+        }
+        level.swap(upper);
+    }
+    uint8_t final[1 + 1 + 8 + 8 + 32];
+    final[0] = 0x02;
+    final[1] = SM3Tree::VERSION;
+    for (int i = 0; i < 8; i++) {
+        final[2 + i] = static_cast<uint8_t>(static_cast<uint64_t>(leafSize) >> (56 - i * 8));
+        final[10 + i] = static_cast<uint8_t>(static_cast<uint64_t>(len) >> (56 - i * 8));
+    }
+    memcpy(final + 18, level[0].data(), 32);
+    SM3::hash(final, sizeof(final), out);
+}
+
+// selftest [] []
+static int runSelfTest(int argc, char* argv[]) {
+    unsigned rounds = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 500;
+    unsigned long long seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 2025;
+    int failures = 0;
+    auto check = [&](bool ok, const char* what, size_t len) {
+        if (!ok) {
+            failures++;
+            cerr << "ʧ: " << what << "  " << len << endl;
+        }
+    };
+
+    // ׼
+    string abcd;
+    for (int i = 0; i < 16; i++) {
+        abcd += "abcd";
+    }
+    check(sm3_hash("abc") == "66c7f0f462eeedd9d1f2d46bdc10e4e24167c4875cf2f7a2297da02b8f4ba8e0",
+        "GB/T 32905 1", 3);
+    check(sm3_hash(abcd) == "debe9ff92275b8a138604889c18e5a4d6fdb70e5387e5765293dcba39c0c5732",
+        "GB/T 32905 2", 64);
+
+    mt19937_64 rng(seed);
+    const SM3Kernels& kernel = sm3Compress();
+    vector<uint8_t> buf(64 * 300 + 64);
+    for (unsigned r = 0; r < rounds; r++) {
+        size_t len = (r % 8 == 0) ? rng() % (64 * 300) : rng() % 300;
+        uint8_t* data = buf.data() + rng() % 64;
+        for (size_t i = 0; i < len; i++) {
+            data[i] = static_cast<uint8_t>(rng());
+        }
+
+        // ѹʵʵ
+        uint32_t st[8], stRef[8];
+        for (int i = 0; i < 8; i++) {
+            st[i] = stRef[i] = static_cast<uint32_t>(rng());
+        }
+        kernel.compress(st, data, len / 64);
+        compressScalar(stRef, data, len / 64);
+        check(memcmp(st, stRef, sizeof(st)) == 0, "ѹ", len);
+
+        // зֵĶupdate
+        SM3 once, pieces;
+        once.update(data, len);
+        once.finalize();
+        for (size_t pos = 0; pos < len;) {
+            size_t n = min(len - pos, static_cast<size_t>(rng() % 150));
+            pieces.update(data + pos, n);
+            pos += n;
+        }
+        pieces.finalize();
+        check(once.digest() == pieces.digest(), "ֶupdate", len);
+
+        // ;ĺֱ
+        size_t split = len > 0 ? rng() % (len + 1) : 0;
+        SM3 prefix;
+        prefix.update(data, split);
+        SM3 clone = prefix;
+        clone.update(data + split, len - split);
+        clone.finalize();
+        uint8_t expect[32], actual[32];
+        once.digest(expect);
+        clone.digest(actual);
+        check(memcmp(expect, actual, 32) == 0, "", len);
+
+        // գͬһλñָµļĻĿӦܾ
+        SM3Snapshot snap;
+        prefix.snapshot(snap);
+        SM3 resumed;
+        resumed.update(data, rng() % 100);
+        check(resumed.restore(snap) && resumed.length() == split, "ջָ", len);
+        resumed.update(data + split, len - split);
+        resumed.finalize();
+        resumed.digest(actual);
+        check(memcmp(expect, actual, 32) == 0, "ջָ", len);
+        SM3Snapshot bad = snap;
+        bad.bytes[rng() % 8] ^= 0x40;
+        check(!resumed.restore(bad), "ոʽ", len);
+        if (split % 64 != 0) {
+            bad = snap;
+            bad.bytes[SM3Snapshot::SIZE - 1] ^= 1;
+            check(!resumed.restore(bad), "", len);
+        }
+    }
+
+    // ໺壺ÿֵ֧ʵ֣ȵһϢȽ
+    const SM3Impl laneImpls[] = { SM3Impl::Scalar, SM3Impl::AVX2, SM3Impl::AVX512 };
+    for (SM3Impl impl : laneImpls) {
+        SM3MultiBuffer mb;
+        if (!mb.setImpl(impl)) {
+            continue;
+        }
+        for (unsigned r = 0; r < rounds / 10 + 1; r++) {
+            size_t count = rng() % 40;
+            vector<vector<uint8_t>> msgs(count);
+            vector<SM3Job> jobs(count);
+            vector<uint8_t> digests(count * 32);
+            for (size_t i = 0; i < count; i++) {
+                msgs[i].resize(rng() % 4 == 0 ? rng() % 2000 : rng() % 130);
+                for (uint8_t& b : msgs[i]) {
+                    b = static_cast<uint8_t>(rng());
+                }
+                jobs[i] = { msgs[i].data(), msgs[i].size(), digests.data() + i * 32 };
+            }
+            mb.hash(jobs.data(), count);
+            for (size_t i = 0; i < count; i++) {
+                SM3 one;
+                one.update(msgs[i].data(), msgs[i].size());
+                one.finalize();
+                uint8_t expect[32];
+                one.digest(expect);
+                check(memcmp(digests.data() + i * 32, expect, 32) == 0, mb.implName(), msgs[i].size());
+            }
+        }
+    }
+
+    // HMAC-SM3RFC 4231126룬ֵOpenSSL
+    struct HmacVector {
+        const char* key;
+        const char* msg;
+        const char* mac;
+    };
+    string longKey(131, '\xAA');
+    const HmacVector hmacVectors[] = {
+        { "\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b", "Hi There",
+            "51b00d1fb49832bfb01c3ce27848e59f871d9ba938dc563b338ca964755cce70" },
+        { "Jefe", "what do ya want for nothing?",
+            "2e87f1d16862e6d964b50a5200bf2b10b764faa9680a296a2405f24bec39f882" },
+        { longKey.c_str(), "Test Using Larger Than Block-Size Key - Hash Key First",
+            "b4fd844e13342002f0b2e0690ea7741f1497d993a70494cea601e657bedf67a0" },
+    };
+    for (const HmacVector& v : hmacVectors) {
+        SM3HMAC hmac(reinterpret_cast<const uint8_t*>(v.key), strlen(v.key));
+        uint8_t tag[32];
+        hmac.mac(reinterpret_cast<const uint8_t*>(v.msg), strlen(v.msg), tag);
+        check(SM3::toHex(tag) == v.mac, "HMAC-SM3", strlen(v.msg));
+    }
+
+    // HMAC-SM3ֵʵSM3ֱӼȽϣӿʵ뵥Ƚ
+    for (unsigned r = 0; r < rounds / 10 + 1; r++) {
+        vector<uint8_t> key(rng() % 150);
+        for (uint8_t& b : key) {
+            b = static_cast<uint8_t>(rng());
+        }
+        SM3HMAC hmac(key.data(), key.size());
+
+        size_t count = rng() % 40;
+        vector<vector<uint8_t>> msgs(count);
+        vector<SM3Job> jobs(count);
+        vector<uint8_t> tags(count * 32), batch(count * 32);
+        for (size_t i = 0; i < count; i++) {
+            msgs[i].resize(rng() % 4 == 0 ? rng() % 1000 : rng() % 100);
+            for (uint8_t& b : msgs[i]) {
+                b = static_cast<uint8_t>(rng());
+            }
+            hmac.mac(msgs[i].data(), msgs[i].size(), tags.data() + i * 32);
+            jobs[i] = { msgs[i].data(), msgs[i].size(), batch.data() + i * 32 };
+
+            uint8_t k[64] = { 0 }, pad[64], innerDigest[32], expect[32];
+            if (key.size() > 64) {
+                SM3::hash(key.data(), key.size(), k);
+            }
+            else if (!key.empty()) {
+                memcpy(k, key.data(), key.size());
+            }
+            SM3 innerCtx, outerCtx;
+            for (int j = 0; j < 64; j++) {
+                pad[j] = k[j] ^ 0x36;
+            }
+            innerCtx.update(pad, 64);
+            innerCtx.update(msgs[i].data(), msgs[i].size());
+            innerCtx.finalize();
+            innerCtx.digest(innerDigest);
+            for (int j = 0; j < 64; j++) {
+                pad[j] = k[j] ^ 0x5C;
+            }
+            outerCtx.update(pad, 64);
+            outerCtx.update(innerDigest, 32);
+            outerCtx.finalize();
+            outerCtx.digest(expect);
+            check(memcmp(expect, tags.data() + i * 32, 32) == 0, "HMAC-SM3", msgs[i].size());
+            check(hmac.verify(msgs[i].data(), msgs[i].size(), expect), "HMAC-SM3У", msgs[i].size());
+        }
+        for (SM3Impl impl : laneImpls) {
+            if (!sm3ImplSupported(impl)) {
+                continue;
+            }
+            hmac.macMany(jobs.data(), count, impl);
+            check(batch == tags, "HMAC-SM3", count);
+        }
+    }
+
+    // ϣȣ0..Լ40Ҷӣзֵʽ롢ͬ߳Ƚ
+    vector<uint8_t> treeData(40 * 4096 + 100);
+    for (uint8_t& b : treeData) {
+        b = static_cast<uint8_t>(rng());
+    }
+    for (unsigned r = 0; r < rounds / 20 + 1; r++) {
+        size_t leafSize = (r % 2 == 0) ? 4096 : 8192;
+        size_t len = (r % 5 == 0) ? rng() % 3 * leafSize : rng() % treeData.size();
+        uint8_t expect[32], actual[32];
+        treeHashReference(treeData.data(), len, leafSize, expect);
+
+        SM3Tree tree(static_cast<unsigned>(rng() % 4 + 1));
+        tree.setLeafSize(leafSize);
+        uint64_t leaves = 0;
+        tree.setLeafCallback([&](uint64_t index, const uint8_t*) {
+            check(index == leaves++, "ϣҶ˳", len);
+        });
+        for (size_t pos = 0; pos < len;) {
+            size_t n = min(len - pos, static_cast<size_t>(rng() % (3 * leafSize)));
+            tree.update(treeData.data() + pos, n);
+            pos += n;
+        }
+        tree.finalize(actual);
+        check(memcmp(expect, actual, 32) == 0, "ϣ", len);
+        check(leaves == max(static_cast<size_t>(1), (len + leafSize - 1) / leafSize), "ϣҶ", len);
+
+        // һ루߳ʱһֻһֱͨӼڴ·
+        check(SM3Tree::hash(treeData.data(), len, actual, 1, leafSize) && memcmp(expect, actual, 32) == 0,
+            "ϣһԣ", len);
+        check(!SM3Tree::hash(treeData.data(), len, actual, 1, leafSize + 1), "ϣҶӴС", len);
+    }
+
+    // ޵ĴҶӣҶʽ㣬仺зֵ룬
+    // Ҷӱ߽һθҶӵ
+    {
+        const size_t bigLeaves[] = { SM3Tree::MAX_BATCH_BYTES + 4096, static_cast<size_t>(1) << 30 };
+        vector<uint8_t> big(2 * bigLeaves[0] + 100);
+        for (size_t i = 0; i < big.size(); i++) {
+            big[i] = static_cast<uint8_t>(i * 131 + (i >> 12));
+        }
+        for (size_t leafSize : bigLeaves) {
+            for (size_t len : { big.size(), static_cast<size_t>(rng() % (4 << 20)) }) {
+                uint8_t expect[32], actual[32];
+                treeHashReference(big.data(), len, leafSize, expect);
+                SM3Tree tree(2);
+                check(tree.setLeafSize(leafSize), "ϣҶ", len);
+                for (size_t pos = 0; pos < len;) {
+                    size_t n = min(len - pos, rng() % 2 == 0 ? static_cast<size_t>(rng() % (8 << 20))
+                        : leafSize + rng() % 1000);
+                    tree.update(big.data() + pos, n);
+                    pos += n;
+                }
+                tree.finalize(actual);
+                check(memcmp(expect, actual, 32) == 0, "ϣҶ", len);
+            }
+        }
+    }
+
+    // KDFȵZβԽ߽ȣʵ֡ͬ߳
+    // мȽ
+    for (unsigned r = 0; r < rounds / 10 + 1; r++) {
+        vector<uint8_t> z(r % 4 == 0 ? 64 : rng() % 200);
+        for (uint8_t& b : z) {
+            b = static_cast<uint8_t>(rng());
+        }
+        size_t len = (r % 8 == 0) ? rng() % 40000 : rng() % 1000;
+        vector<uint8_t> expect((len + 31) / 32 * 32), actual(len + 1, 0xEE);
+        for (size_t i = 0; i * 32 < len; i++) {
+            uint8_t ct[4];
+            storeBE32(ct, static_cast<uint32_t>(i + 1));
+            SM3 ctx;
+            ctx.update(z.data(), z.size());
+            ctx.update(ct, 4);
+            ctx.finalize();
+            ctx.digest(expect.data() + i * 32);
+        }
+        for (SM3Impl impl : laneImpls) {
+            SM3KDF kdf(z.data(), z.size());
+            if (!kdf.setImpl(impl)) {
+                continue;
+            }
+            kdf.setThreads(static_cast<unsigned>(rng() % 3 + 1));
+            check(kdf.derive(actual.data(), len) && memcmp(expect.data(), actual.data(), len) == 0
+                && actual[len] == 0xEE, "KDF", len);
+        }
+    }
+
+    // PBKDF2-HMAC-SM3֪OpenSSLĽһ£Ρȵһҵ
+    // ʵֱӰHMACĽȽ
+    struct PbkdfVector {
+        const char* password;
+        const char* salt;
+        uint32_t iterations;
+        const char* key;
+    };
+    const PbkdfVector pbkdfVectors[] = {
+        { "password", "salt", 1, "4612f922a1fdcefaf4312fc6f8f3322b489cbf24f2ea361b44c2bd8fa2c6dcb0" },
+        { "password", "salt", 2, "fee723a2bc966e11dffb66133f4e8df577383c78ade30e3298edbd3e54ed85b7" },
+        { "password", "salt", 4096, "b6e8f2074c87432b78f62e5ced980fdff89e86af2f693dab1638e2b3683045dd" },
+        { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096,
+            "3b6282ac8519f059e465abff0ea37b0dbfe6c672a76e6b805312d53900db630732ccc1a88fa5512a" },
+    };
+    for (const PbkdfVector& v : pbkdfVectors) {
+        size_t keyLen = strlen(v.key) / 2;
+        vector<uint8_t> key(keyLen), expect(keyLen);
+        for (size_t i = 0; i < keyLen; i++) {
+            expect[i] = static_cast<uint8_t>(stoul(string(v.key + i * 2, 2), nullptr, 16));
+        }
+        SM3PBKDF2::derive(reinterpret_cast<const uint8_t*>(v.password), strlen(v.password),
+            reinterpret_cast<const uint8_t*>(v.salt), strlen(v.salt), v.iterations, key.data(), keyLen);
+        check(key == expect, "PBKDF2-HMAC-SM3", keyLen);
+        check(SM3PBKDF2::verify(reinterpret_cast<const uint8_t*>(v.password), strlen(v.password),
+            reinterpret_cast<const uint8_t*>(v.salt), strlen(v.salt), v.iterations, expect.data(), keyLen),
+            "PBKDF2-HMAC-SM3У", keyLen);
+        check(!SM3PBKDF2::verify(reinterpret_cast<const uint8_t*>("wrong"), 5,
+            reinterpret_cast<const uint8_t*>(v.salt), strlen(v.salt), v.iterations, expect.data(), keyLen)
+            && !SM3PBKDF2::verify(reinterpret_cast<const uint8_t*>(v.password), strlen(v.password),
+            reinterpret_cast<const uint8_t*>(v.salt), strlen(v.salt), v.iterations, expect.data(), 0),
+            "PBKDF2-HMAC-SM3У飨ܾ", keyLen);
+    }
+    for (unsigned r = 0; r < rounds / 50 + 1; r++) {
+        size_t count = rng() % 40;
+        vector<vector<uint8_t>> secrets(count * 2);
+        vector<SM3PBKDF2Job> jobs(count);
+        vector<vector<uint8_t>> expect(count), actual(count);
+        for (size_t i = 0; i < count; i++) {
+            secrets[i * 2].resize(rng() % 100);
+            secrets[i * 2 + 1].resize(rng() % 80);
+            for (size_t k = i * 2; k < i * 2 + 2; k++) {
+                for (uint8_t& b : secrets[k]) {
+                    b = static_cast<uint8_t>(rng());
+                }
+            }
+            uint32_t iterations = static_cast<uint32_t>(rng() % 4 == 0 ? 1 : rng() % 60 + 1);
+            size_t outLen = rng() % 100;
+            const vector<uint8_t>& pw = secrets[i * 2];
+            const vector<uint8_t>& salt = secrets[i * 2 + 1];
+            expect[i].assign((outLen + 31) / 32 * 32, 0);
+            actual[i].assign(outLen, 0);
+            jobs[i] = { pw.data(), pw.size(), salt.data(), salt.size(), iterations, actual[i].data(), outLen };
+
+            SM3HMAC hmac(pw.data(), pw.size());
+            for (uint32_t block = 1; (block - 1) * 32 < outLen; block++) {
+                vector<uint8_t> msg(salt);
+                msg.resize(salt.size() + 4);
+                storeBE32(msg.data() + salt.size(), block);
+                uint8_t u[32];
+                hmac.mac(msg.data(), msg.size(), u);
+                uint8_t* t = expect[i].data() + (block - 1) * 32;
+                memcpy(t, u, 32);
+                for (uint32_t j = 1; j < iterations; j++) {
+                    hmac.mac(u, 32, u);
+                    for (int k = 0; k < 32; k++) {
+                        t[k] ^= u[k];
+                    }
+                }
+            }
+            expect[i].resize(outLen);
+        }
+        for (SM3Impl impl : laneImpls) {
+            SM3PBKDF2 pbkdf2;
+            if (!pbkdf2.setImpl(impl)) {
+                continue;
+            }
+            for (size_t i = 0; i < count; i++) {
+                fill(actual[i].begin(), actual[i].end(), 0);
+            }
+            check(pbkdf2.deriveMany(jobs.data(), count) && actual == expect, "PBKDF2-HMAC-SM3", count);
+        }
+    }
+
+    cout << "׼ֲ: " << rounds << "  " << seed << ""
+        << (failures == 0 ? "ȫͨ" : "ʧ") << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// ==================== ܲԣbench ====================
+// ÿģʽݳȣԤȣʱԤڷãTSC¼ÿεõ
+// λ99λӳ١ÿֽJSON׼
+// ύ֮Ƚϣȱ׼
+
+struct BenchResult {
+    size_t calls;
+    double cyclesPerByte;   // λӳټ
+    double gbps;            // ȫõƽ
+    double p50Ns;
+    double p99Ns;
+};
+
+// TSCƵʣÿļ
+static double tscPerNs() {
+    auto t0 = chrono::steady_clock::now();
+    unsigned long long c0 = __rdtsc();
+    while (chrono::steady_clock::now() - t0 < chrono::milliseconds(50)) {
+    }
+    unsigned long long c1 = __rdtsc();
+    chrono::duration<double, nano> ns = chrono::steady_clock::now() - t0;
+    return static_cast<double>(c1 - c0) / ns.count();
+}
+
+// ԤԼʮ֮һԤʱ5εã100000
+template <typename F>
+static BenchResult benchmarkCall(size_t bytes, double budgetMs, double tscNs, const F& call) {
+    auto warmEnd = chrono::steady_clock::now() + chrono::duration<double, milli>(budgetMs / 10);
+    do {
+        call();
+    } while (chrono::steady_clock::now() < warmEnd);
+
+    vector<unsigned long long> samples;
+    unsigned long long total = 0;
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double, milli>(budgetMs);
+    do {
+        unsigned long long c0 = __rdtsc();
+        call();
+        unsigned long long c1 = __rdtsc();
+        samples.push_back(c1 - c0);
+        total += c1 - c0;
+    } while ((samples.size() < 5 || chrono::steady_clock::now() < deadline) && samples.size() < 100000);
+
+    sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    BenchResult r;
+    r.calls = n;
+    r.cyclesPerByte = static_cast<double>(samples[n / 2]) / bytes;
+    r.gbps = static_cast<double>(bytes) * n / (static_cast<double>(total) / tscNs);
+    r.p50Ns = samples[n / 2] / tscNs;
+    r.p99Ns = samples[min(n - 1, n * 99 / 100)] / tscNs;
+    return r;
+}
+
+// K/M/G׺ֽ
+static size_t parseSize(const char* s) {
+    char* end = nullptr;
+    double v = strtod(s, &end);
+    switch (end != nullptr ? *end : '\0') {
+    case 'K': case 'k': v *= 1024; break;
+    case 'M': case 'm': v *= 1024 * 1024; break;
+    case 'G': case 'g': v *= 1024.0 * 1024 * 1024; break;
+    default: break;
+    }
+    return static_cast<size_t>(v);
+}
+
+// bench [--min-size N] [--max-size N] [--time-ms T] [--mode ]
+// hashΪupdate+finalize䣩compressֻѹȰ64ֽȡ·ʵ֣
+// multiΪ໺ɢУÿΪóȵϢԼ4MB4096ʵֲԣ
+// hmacΪͬһԿµHMAC-SM3macʵֵmacManyĴСͬmulti
+// treeΪϣĬϲȫ߼ˣkdfΪSM2KDF64ֽZΪֽ
+// мʵֵpbkdf2ΪPBKDF2-HMAC-SM3ΪһĿ
+// ÿ1000ε32ֽڣderiveʵֵderiveMany
+// ȴmin-sizeÿγ4Ĭ16B..16MBɵ1G
+static int runBenchmark(int argc, char* argv[]) {
+    size_t minSize = 16, maxSize = 16 << 20;
+    double budgetMs = 20;
+    const char* onlyMode = nullptr;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--min-size") == 0) {
+            minSize = max(static_cast<size_t>(1), parseSize(argv[i + 1]));
+        }
+        else if (strcmp(argv[i], "--max-size") == 0) {
+            maxSize = parseSize(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--time-ms") == 0) {
+            budgetMs = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--mode") == 0) {
+            onlyMode = argv[i + 1];
+        }
+        else {
+            cerr << "δ֪: " << argv[i] << endl;
+            return 2;
+        }
+    }
+
+    vector<uint8_t> data(maxSize, 0x5A);
+    const char* modes[] = { "hash", "compress", "multi", "hmac", "tree", "kdf", "pbkdf2" };
+    const SM3Kernels& kernel = sm3Compress();
+
+    double tscNs = tscPerNs();
+    cout << "{\n  \"benchmark\": \"sm3\",\n  \"tsc_ghz\": " << fixed << setprecision(3) << tscNs
+        << ",\n  \"results\": [";
+    cerr << fixed << left << setw(10) << "mode" << setw(8) << "impl" << right << setw(12) << "bytes"
+        << setw(10) << "cpb" << setw(10) << "GB/s" << setw(14) << "p50(ns)" << setw(14) << "p99(ns)" << endl;
+
+    bool first = true;
+    auto report = [&](const char* mode, const char* impl, size_t bytes, const BenchResult& r) {
+        cout << (first ? "\n" : ",\n") << "    {\"mode\": \"" << mode << "\", \"impl\": \"" << impl
+            << "\", \"bytes\": " << bytes << ", \"calls\": " << r.calls
+            << setprecision(3) << ", \"cycles_per_byte\": " << r.cyclesPerByte
+            << ", \"gb_per_s\": " << r.gbps << ", \"p50_ns\": " << setprecision(1) << r.p50Ns
+            << ", \"p99_ns\": " << r.p99Ns << "}";
+        first = false;
+        cerr << left << setw(10) << mode << setw(8) << impl << right << setw(12) << bytes
+            << setprecision(2) << setw(10) << r.cyclesPerByte << setprecision(3) << setw(10) << r.gbps
+            << setprecision(1) << setw(14) << r.p50Ns << setw(14) << r.p99Ns << endl;
+    };
+
+    const SM3Impl impls[] = { SM3Impl::Scalar, SM3Impl::AVX2, SM3Impl::AVX512 };
+    for (const char* mode : modes) {
+        if (onlyMode != nullptr && strcmp(onlyMode, mode) != 0) {
+            continue;
+        }
+        bool compressOnly = strcmp(mode, "compress") == 0;
+        bool multi = strcmp(mode, "multi") == 0;
+        bool hmacMode = strcmp(mode, "hmac") == 0;
+        for (size_t size = minSize; size <= maxSize; size *= 4) {
+            size_t bytes = compressOnly ? size / 64 * 64 : size;
+            if (bytes == 0) {
+                continue;
+            }
+            if (multi || hmacMode) {
+                // bytesΪÿϢĳȣ
+                size_t count = max(static_cast<size_t>(1), min(static_cast<size_t>(4096), (4 << 20) / size));
+                vector<uint8_t> messages(count * size, 0x5A);
+                vector<uint8_t> digests(count * 32);
+                vector<SM3Job> jobs(count);
+                for (size_t i = 0; i < count; i++) {
+                    jobs[i] = { messages.data() + i * size, size, digests.data() + i * 32 };
+                }
+                const uint8_t hmacKey[32] = { 0x4B };
+                SM3HMAC hmac(hmacKey, sizeof(hmacKey));
+                if (hmacMode) {
+                    // mac·ѹ
+                    BenchResult r = benchmarkCall(count * size, budgetMs, tscNs, [&] {
+                        for (size_t i = 0; i < count; i++) {
+                            hmac.mac(jobs[i].data, size, jobs[i].digest);
+                        }
+                    });
+                    report(mode, "single", bytes, r);
+                }
+                for (SM3Impl impl : impls) {
+                    SM3MultiBuffer mb;
+                    if (!mb.setImpl(impl)) {
+                        continue;
+                    }
+                    BenchResult r = hmacMode
+                        ? benchmarkCall(count * size, budgetMs, tscNs, [&] { hmac.macMany(jobs.data(), count, impl); })
+                        : benchmarkCall(count * size, budgetMs, tscNs, [&] { mb.hash(jobs.data(), count); });
+                    report(mode, sm3LaneKernels(impl)->id, bytes, r);
+                }
+            }
+            else {
+                uint32_t st[8] = { 0 };
+                if (compressOnly) {
+                    // ·ʵ
+                    for (SM3Impl impl : impls) {
+                        if (!sm3CompressSupported(impl)) {
+                            continue;
+                        }
+                        const SM3Kernels* k = sm3CompressKernel(impl);
+                        BenchResult r = benchmarkCall(bytes, budgetMs, tscNs, [&] { k->compress(st, data.data(), bytes / 64); });
+                        report(mode, k->id, bytes, r);
+                    }
+                }
+                else if (strcmp(mode, "kdf") == 0) {
+                    uint8_t z[64];
+                    memset(z, 0x5A, sizeof(z));
+                    vector<uint8_t> out(bytes);
+                    BenchResult r = benchmarkCall(bytes, budgetMs, tscNs, [&] {
+                        for (size_t i = 0; i * 32 < bytes; i++) {
+                            uint8_t ct[4], digest[32];
+                            storeBE32(ct, static_cast<uint32_t>(i + 1));
+                            SM3 ctx;
+                            ctx.update(z, 64);
+                            ctx.update(ct, 4);
+                            ctx.finalize();
+                            ctx.digest(digest);
+                            memcpy(out.data() + i * 32, digest, min(static_cast<size_t>(32), bytes - i * 32));
+                        }
+                    });
+                    report(mode, "single", bytes, r);
+                    for (SM3Impl impl : impls) {
+                        SM3KDF kdf(z, 64);
+                        if (!kdf.setImpl(impl)) {
+                            continue;
+                        }
+                        r = benchmarkCall(bytes, budgetMs, tscNs, [&] { kdf.derive(out.data(), bytes); });
+                        report(mode, sm3LaneKernels(impl)->id, bytes, r);
+                    }
+                }
+                else if (strcmp(mode, "pbkdf2") == 0) {
+                    // ֽ
+                    const uint32_t iterations = 1000;
+                    size_t count = min(bytes, static_cast<size_t>(4096));
+                    vector<uint8_t> passwords(count * 8), keys(count * 32);
+                    const uint8_t salt[16] = { 0x53 };
+                    vector<SM3PBKDF2Job> jobs(count);
+                    for (size_t i = 0; i < count; i++) {
+                        storeBE32(passwords.data() + i * 8, static_cast<uint32_t>(i));
+                        jobs[i] = { passwords.data() + i * 8, 8, salt, sizeof(salt), iterations, keys.data() + i * 32, 32 };
+                    }
+                    BenchResult r = benchmarkCall(count * 32, budgetMs, tscNs, [&] {
+                        for (const SM3PBKDF2Job& j : jobs) {
+                            SM3PBKDF2::derive(j.password, j.passwordLen, j.salt, j.saltLen, j.iterations, j.out, j.outLen);
+                        }
+                    });
+                    report(mode, "single", count, r);
+                    for (SM3Impl impl : impls) {
+                        SM3PBKDF2 pbkdf2;
+                        if (!pbkdf2.setImpl(impl)) {
+                            continue;
+                        }
+                        r = benchmarkCall(count * 32, budgetMs, tscNs, [&] { pbkdf2.deriveMany(jobs.data(), count); });
+                        report(mode, sm3LaneKernels(impl)->id, count, r);
+                    }
+                    if (count == 4096) {
+                        break;
+                    }
+                }
+                else if (strcmp(mode, "tree") == 0) {
+                    uint8_t out[32];
+                    BenchResult r = benchmarkCall(bytes, budgetMs, tscNs, [&] { SM3Tree::hash(data.data(), bytes, out); });
+                    report(mode, "tree-v1", bytes, r);
+                }
+                else {
+                    BenchResult r = benchmarkCall(bytes, budgetMs, tscNs, [&] {
+                        SM3 sm3;
+                        sm3.update(data.data(), bytes);
+                        sm3.finalize();
+                    });
+                    report(mode, kernel.id, bytes, r);
+                }
+            }
+            if (size > maxSize / 4) {
+                break;
+            }
+        }
+    }
+    cout << "\n  ]\n}" << endl;
+    return 0;
+}
+
+// tree <ļ|-> [ҶӴС]ʽȡļ-Ϊ׼룩ϣժҪ
+static int runTreeHash(const char* path, size_t leafSize) {
+    SM3Tree tree;
+    if (!tree.setLeafSize(leafSize)) {
+        cerr << "ҶӴСΪ64ıΧ4K..1G" << endl;
+        return 2;
+    }
+    FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (in == nullptr) {
+        cerr << "޷ " << path << endl;
+        return 1;
+    }
+    // ÿζһ32 MiBֱڶϼ
+    vector<uint8_t> chunk(static_cast<size_t>(32) << 20);
+    size_t n;
+    while ((n = fread(chunk.data(), 1, chunk.size(), in)) > 0) {
+        tree.update(chunk.data(), n);
+    }
+    bool ok = !ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (!ok) {
+        cerr << "ȡʧ: " << path << endl;
+        return 1;
+    }
+    uint8_t root[32];
+    tree.finalize(root);
+    cout << SM3::toHex(root) << "  " << path << endl;
+    return 0;
+}
+
+// append <״̬ļ> <ļ|->׷ɢֻĵ־״̬ļʱлָģ
+// ݺдؿգдʱļٸ;ʧܻԭ״̬
+// ĿǰȫݵժҪܳ
+static int runAppend(const char* statePath, const char* path) {
+    SM3 sm3;
+    SM3Snapshot snap;
+    // ֻ״̬ļʱŴͷʼʧܣȨޡI/OҲ־
+    // дʱḲԭ״̬ʧ֮ǰȫʷ
+    FILE* state = fopen(statePath, "rb");
+    if (state != nullptr) {
+        bool ok = fread(snap.bytes, 1, SM3Snapshot::SIZE, state) == SM3Snapshot::SIZE && sm3.restore(snap);
+        fclose(state);
+        if (!ok) {
+            cerr << "״̬ļʽȷ: " << statePath << endl;
+            return 1;
+        }
+    }
+    else if (errno != ENOENT) {
+        cerr << "޷״̬ļ: " << statePath << " (" << strerror(errno) << ")" << endl;
+        return 1;
+    }
+
+    FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (in == nullptr) {
+        cerr << "޷ " << path << endl;
+        return 1;
+    }
+    vector<uint8_t> chunk(1 << 20);
+    size_t n;
+    while ((n = fread(chunk.data(), 1, chunk.size(), in)) > 0) {
+        sm3.update(chunk.data(), n);
+    }
+    bool readOk = !ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (!readOk) {
+        cerr << "ȡʧ: " << path << endl;
+        return 1;
+    }
+
+    sm3.snapshot(snap);
+    string tmpPath = string(statePath) + ".tmp";
+    FILE* out = fopen(tmpPath.c_str(), "wb");
+    bool written = out != nullptr && fwrite(snap.bytes, 1, SM3Snapshot::SIZE, out) == SM3Snapshot::SIZE
+        && fflush(out) == 0;
+    // ǰ̣¸ĹΪյ״̬ļ
+#ifdef _WIN32
+    written = written && _commit(_fileno(out)) == 0;
+#else
+    written = written && fsync(fileno(out)) == 0;
+#endif
+    if (out != nullptr) {
+        written = fclose(out) == 0 && written;
+    }
+    bool renamed = false;
+    if (written) {
+#ifdef _WIN32
+        // CRTrenameѴڵļ
+        error_code ec;
+        filesystem::rename(tmpPath, statePath, ec);
+        renamed = !ec;
+#else
+        renamed = rename(tmpPath.c_str(), statePath) == 0;
+#endif
+    }
+    if (!renamed) {
+        remove(tmpPath.c_str());
+        cerr << "޷д״̬ļ: " << statePath << endl;
+        return 1;
+    }
+
+    // ڸϽ㣬״̬ļеԿɼ׷
+    SM3 current = sm3;
+    current.finalize();
+    uint8_t digest[32];
+    current.digest(digest);
+    cout << SM3::toHex(digest) << "  " << current.length() << " bytes" << endl;
+    return 0;
+}
+
+// test
+int main(int argc, char* argv[]) {
+    // selftestԼ죬benchܲԣJSONtreeϣappend׷ɢ
+    if (argc > 1) {
+        int status;
+        if (strcmp(argv[1], "selftest") == 0) {
+            status = runSelfTest(argc, argv);
+        }
+        else if (strcmp(argv[1], "bench") == 0) {
+            status = runBenchmark(argc, argv);
+        }
+        else if (argc == 4 && strcmp(argv[1], "append") == 0) {
+            status = runAppend(argv[2], argv[3]);
+        }
+        else if ((argc == 3 || argc == 4) && strcmp(argv[1], "tree") == 0) {
+            status = runTreeHash(argv[2], argc == 4 ? parseSize(argv[3]) : SM3Tree::DEFAULT_LEAF_SIZE);
+        }
+        else {
+            cerr << "÷:" << endl;
+            cerr << "  " << argv[0] << " selftest [] []" << endl;
+            cerr << "  " << argv[0] << " bench [--min-size 16] [--max-size 16M] [--time-ms 20] [--mode hash|compress|multi|hmac|tree|kdf|pbkdf2]" << endl;
+            cerr << "  " << argv[0] << " tree <ļ|-> [ҶӴСĬ1M]" << endl;
+            cerr << "  " << argv[0] << " append <״̬ļ> <ļ|->" << endl;
+            return 2;
+        }
+#ifdef SM3_INSTRUMENT
+        cerr << SM3Metrics::exportText();
+#endif
+        return status;
+    }
+
+    cout << "SM3(\"abc\") = " << sm3_hash("abc") << endl;
+    cout << "SM3(\"abcdabcdabcdabcdabcdabcdabcd\") = "<< sm3_hash("abcdabcdabcdabcdabcdabcdabcd") << endl;
+
+    string long_str(1024 * 1024, 'a');
+    clock_t start = clock();
+    string hash = sm3_hash(long_str);
+    clock_t end = clock();
+    cout << "Time for 1MB data: "
+        << (double)(end - start) / CLOCKS_PER_SEC * 1000
+        << " ms" << endl;
+
+    // ໺壺10000064ֽϢ
+    const size_t MSG_COUNT = 100000, MSG_LEN = 64;
+    vector<uint8_t> messages(MSG_COUNT * MSG_LEN);
+    for (size_t i = 0; i < messages.size(); i++) {
+        messages[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+    vector<uint8_t> digests(MSG_COUNT * 32);
+    vector<SM3Job> jobs(MSG_COUNT);
+    for (size_t i = 0; i < MSG_COUNT; i++) {
+        jobs[i] = { messages.data() + i * MSG_LEN, MSG_LEN, digests.data() + i * 32 };
+    }
+    SM3MultiBuffer mb;
+    auto mbStart = chrono::high_resolution_clock::now();
+    mb.hash(jobs.data(), MSG_COUNT);
+    chrono::duration<double, milli> mbElapsed = chrono::high_resolution_clock::now() - mbStart;
+    cout << "Multi-buffer (" << mb.implName() << ") " << MSG_COUNT << " x " << MSG_LEN << "B: "
+        << mbElapsed.count() << " ms" << endl;
+
+    SM3 last;
+    last.update(messages.data() + (MSG_COUNT - 1) * MSG_LEN, MSG_LEN);
+    last.finalize();
+    uint8_t lastDigest[32];
+    last.digest(lastDigest);
+    cout << "Multi-buffer check: "
+        << (memcmp(lastDigest, digests.data() + (MSG_COUNT - 1) * 32, 32) == 0 ? "OK" : "MISMATCH") << endl;
+
+    // ϣ64MBݣ뵥·SM3ȽϺʱ
+    vector<uint8_t> large(64 << 20, 0x61);
+    uint8_t treeRoot[32];
+    auto treeStart = chrono::high_resolution_clock::now();
+    SM3Tree::hash(large.data(), large.size(), treeRoot);
+    chrono::duration<double, milli> treeElapsed = chrono::high_resolution_clock::now() - treeStart;
+    auto serialStart = chrono::high_resolution_clock::now();
+    uint8_t serialDigest[32];
+    SM3::hash(large.data(), large.size(), serialDigest);
+    chrono::duration<double, milli> serialElapsed = chrono::high_resolution_clock::now() - serialStart;
+    cout << "Tree hash (v1, 1MB leaves) of 64MB: " << treeElapsed.count() << " ms, serial SM3: "
+        << serialElapsed.count() << " ms" << endl;
+    cout << "Tree root = " << SM3::toHex(treeRoot) << endl;
+
+#ifdef SM3_INSTRUMENT
+    cout << "\n=== ʱͳ ===" << endl;
+    cout << SM3Metrics::exportText();
+#endif
 
     return 0;
 }
\ No newline at end of file